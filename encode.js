@@ -1,7 +1,6 @@
 document.getElementById('encodeForm').addEventListener('submit', async (e) => {
   e.preventDefault();
 
-  const formData = new FormData();
   const coverImage = document.getElementById('coverImage').files[0];
   const secretFile = document.getElementById('secretFile').files[0];
 
@@ -10,21 +9,24 @@ document.getElementById('encodeForm').addEventListener('submit', async (e) => {
     return;
   }
 
-  formData.append('coverImage', coverImage);
-  formData.append('secretFile', secretFile);
-
   // Show loading, hide results
   showLoading();
   hideResult();
   hideError();
 
   try {
-    const response = await fetch('/api/encode', {
-      method: 'POST',
-      body: formData
-    });
+    // Covers the server already holds are sent by hash only
+    const coverHash = await sha256Hex(coverImage);
+    const coverKnown = await isCoverStored(coverHash);
 
-    const data = await response.json();
+    const fallback = document.getElementById('fallback').value;
+    let response = await postEncode(coverImage, secretFile, coverKnown ? coverHash : null, fallback);
+    let data = await response.json();
+    if (data.coverMissing) {
+      // Removed from the store since the lookup: upload it after all
+      response = await postEncode(coverImage, secretFile, null, fallback);
+      data = await response.json();
+    }
 
     hideLoading();
 
@@ -39,6 +41,52 @@ document.getElementById('encodeForm').addEventListener('submit', async (e) => {
   }
 });
 
+// Hex SHA-256 of a file, or null where Web Crypto is unavailable (it needs a
+// secure origin such as https or localhost)
+async function sha256Hex(file) {
+  if (!window.crypto || !window.crypto.subtle) {
+    return null;
+  }
+  const digest = await window.crypto.subtle.digest('SHA-256', await file.arrayBuffer());
+  return Array.from(new Uint8Array(digest))
+    .map(byte => byte.toString(16).padStart(2, '0'))
+    .join('');
+}
+
+async function isCoverStored(hash) {
+  if (!hash) {
+    return false;
+  }
+  try {
+    const response = await fetch('/api/covers/lookup', {
+      method: 'POST',
+      headers: { 'Content-Type': 'application/json' },
+      body: JSON.stringify({ hashes: [hash] })
+    });
+    const data = await response.json();
+    return data.success && data.known.includes(hash);
+  } catch (error) {
+    return false;
+  }
+}
+
+function postEncode(coverImage, secretFile, coverHash, fallback) {
+  const formData = new FormData();
+  if (coverHash) {
+    formData.append('coverHash', coverHash);
+    formData.append('coverName', coverImage.name);
+  } else {
+    formData.append('coverImage', coverImage);
+  }
+  formData.append('secretFile', secretFile);
+  formData.append('fallback', fallback);
+
+  return fetch('/api/encode', {
+    method: 'POST',
+    body: formData
+  });
+}
+
 function showLoading() {
   document.getElementById('loading').classList.remove('hidden');
 }
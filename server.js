@@ -1,12 +1,254 @@
 const express = require('express');
 const multer = require('multer');
 const path = require('path');
-const { exec } = require('child_process');
+const { spawn } = require('child_process');
 const fs = require('fs');
+const crypto = require('crypto');
+const os = require('os');
 
 const app = express();
 const PORT = 3000;
 
+// Engine binary, built from stego_cli.cpp (see README, Step 2)
+const ENGINE_PATH = path.join(__dirname, 'stego_cli.exe');
+
+// Per-job events are written by each engine into its own binary log
+// (decode with: stego_cli.exe logdump logs/engine-0/stego-jobs.bin)
+const JOB_LOG_DIR = './logs';
+
+// Interactive encodes get a time budget. An encode estimated over it fails,
+// unless the client chose fallback=append: then the engine appends instead of
+// embedding and reports what it gave up. Calibrate the estimates with:
+//   stego_cli.exe bench --calibrate stego-cost-model.txt
+const ENCODE_DEADLINE_MS = 2000;
+const COST_MODEL_FILE = './stego-cost-model.txt';
+let jobCounter = 0;
+
+function nextJobId() {
+  jobCounter = (jobCounter + 1) & 0xffff;
+  return Date.now().toString(16) + jobCounter.toString(16).padStart(4, '0');
+}
+
+// Jobs run in a small pool of long-lived engine processes
+// ("stego_cli.exe daemon"), which saves a process start per request. Each
+// engine takes one job at a time as a tab-separated line on its stdin and
+// answers with "ok\t<path>[\t<trade-offs>]" or "error\t<message>". Jobs wait
+// in one shared queue, so a large encode holds up only the engine running it.
+const ENGINE_POOL_SIZE = Math.max(2, Math.min(4, os.cpus().length));
+const engines = [];
+const queuedJobs = [];
+
+function startEngine(slot) {
+  const logDir = path.join(JOB_LOG_DIR, 'engine-' + slot);
+  fs.mkdirSync(logDir, { recursive: true });
+  const args = ['daemon', '--joblog', logDir];
+  if (fs.existsSync(COST_MODEL_FILE)) {
+    args.push('--cost-model', COST_MODEL_FILE);
+  }
+  const engine = { slot: slot, process: spawn(ENGINE_PATH, args), output: '', job: null };
+  engine.process.stdin.on('error', () => {}); // reported by the 'exit' handler
+  engine.process.stdout.setEncoding('utf8');
+  engine.process.stdout.on('data', chunk => {
+    engine.output += chunk;
+    let newline;
+    while ((newline = engine.output.indexOf('\n')) >= 0) {
+      const line = engine.output.slice(0, newline).replace(/\r$/, '');
+      engine.output = engine.output.slice(newline + 1);
+      const callback = engine.job;
+      engine.job = null;
+      if (callback) {
+        const fields = line.split('\t');
+        if (fields[0] === 'ok') {
+          callback(null, fields[1], fields[2] || '');
+        } else {
+          callback(new Error(fields.slice(1).join(' ')));
+        }
+      }
+      dispatchJobs();
+    }
+  });
+  engine.process.stderr.on('data', chunk => console.error(`engine ${slot}: ${chunk}`));
+  engine.process.on('error', error => stopEngine(engine, 'Engine failed to start: ' + error.message));
+  engine.process.on('exit', code => stopEngine(engine, `Engine exited with code ${code}`));
+  engines[slot] = engine;
+  return engine;
+}
+
+// A dead engine fails its current job; the slot restarts on the next job
+function stopEngine(engine, message) {
+  if (engines[engine.slot] !== engine) {
+    return;
+  }
+  engines[engine.slot] = null;
+  const callback = engine.job;
+  engine.job = null;
+  if (callback) {
+    callback(new Error(message));
+  }
+  dispatchJobs();
+}
+
+function dispatchJobs() {
+  for (let slot = 0; slot < ENGINE_POOL_SIZE && queuedJobs.length > 0; slot++) {
+    const engine = engines[slot] || startEngine(slot);
+    if (engine.job) {
+      continue;
+    }
+    const next = queuedJobs.shift();
+    engine.job = next.callback;
+    engine.process.stdin.write(next.fields.join('\t') + '\n');
+  }
+}
+
+function runEngineJob(fields, callback) {
+  if (fields.some(field => /[\t\r\n]/.test(field))) {
+    return callback(new Error('File names may not contain tabs or line breaks'));
+  }
+  queuedJobs.push({ fields: fields, callback: callback });
+  dispatchJobs();
+}
+
+// Content-addressed cover store: covers/<sha256 of the content>. Clients ask
+// which covers are already here and send only the hash for those, so a
+// repeat cover costs no upload and no disk write. A hash is only confirmed
+// to the client that uploaded that cover, so the store does not reveal what
+// other users sent. The store is capped by age and total size; the least
+// recently used covers go first.
+const COVER_STORE_DIR = './covers';
+const COVER_STORE_MAX_BYTES = 2 * 1024 * 1024 * 1024;
+const COVER_MAX_AGE_MS = 7 * 24 * 60 * 60 * 1000;
+const COVER_PRUNE_INTERVAL_MS = 60 * 60 * 1000;
+const CLIENT_COOKIE = 'stego_client';
+const CLIENT_ID_HEX = /^[0-9a-f]{32}$/;
+const SHA256_HEX = /^[0-9a-f]{64}$/;
+
+// "<client id>:<hash>" -> time the client last uploaded or used the cover
+const coverGrants = new Map();
+// hash -> number of queued or running jobs reading the cover
+const coversInUse = new Map();
+
+function coverStorePath(hash) {
+  return path.join(COVER_STORE_DIR, hash);
+}
+
+// Each browser gets a random id in an HttpOnly cookie
+function clientId(req, res) {
+  const cookies = String(req.headers.cookie || '').split(';');
+  for (const cookie of cookies) {
+    const [name, value] = cookie.trim().split('=');
+    if (name === CLIENT_COOKIE && CLIENT_ID_HEX.test(value)) {
+      return value;
+    }
+  }
+  const id = crypto.randomBytes(16).toString('hex');
+  res.cookie(CLIENT_COOKIE, id, { httpOnly: true, sameSite: 'strict', maxAge: COVER_MAX_AGE_MS });
+  return id;
+}
+
+function grantCover(client, hash) {
+  coverGrants.set(`${client}:${hash}`, Date.now());
+}
+
+function hasCover(client, hash) {
+  return SHA256_HEX.test(hash) && coverGrants.has(`${client}:${hash}`) &&
+    fs.existsSync(coverStorePath(hash));
+}
+
+// Marks a stored cover as used so eviction keeps it; the returned function
+// releases it once the job is done
+function holdCover(hash) {
+  coversInUse.set(hash, (coversInUse.get(hash) || 0) + 1);
+  const now = new Date();
+  fs.utimes(coverStorePath(hash), now, now, () => {});
+  return () => {
+    const count = coversInUse.get(hash) - 1;
+    if (count > 0) {
+      coversInUse.set(hash, count);
+    } else {
+      coversInUse.delete(hash);
+    }
+  };
+}
+
+// Drops covers unused for COVER_MAX_AGE_MS, then the least recently used
+// ones until the store fits COVER_STORE_MAX_BYTES. Covers held by a job stay.
+function pruneCoverStore() {
+  fs.readdir(COVER_STORE_DIR, (readError, names) => {
+    if (readError) {
+      return console.error('Cover store prune failed:', readError.message);
+    }
+    const covers = [];
+    for (const name of names.filter(name => SHA256_HEX.test(name))) {
+      try {
+        const stats = fs.statSync(coverStorePath(name));
+        covers.push({ hash: name, size: stats.size, used: stats.mtimeMs });
+      } catch (statError) {
+        // Removed meanwhile
+      }
+    }
+    covers.sort((a, b) => a.used - b.used);
+
+    let total = covers.reduce((sum, cover) => sum + cover.size, 0);
+    const cutoff = Date.now() - COVER_MAX_AGE_MS;
+    const evicted = new Set();
+    for (const cover of covers) {
+      if (total <= COVER_STORE_MAX_BYTES && cover.used >= cutoff) {
+        break;
+      }
+      if (coversInUse.has(cover.hash)) {
+        continue;
+      }
+      fs.unlink(coverStorePath(cover.hash), () => {});
+      evicted.add(cover.hash);
+      total -= cover.size;
+    }
+    for (const [key, granted] of coverGrants) {
+      if (granted < cutoff || evicted.has(key.slice(key.indexOf(':') + 1))) {
+        coverGrants.delete(key);
+      }
+    }
+    if (evicted.size > 0) {
+      console.log(`Cover store: evicted ${evicted.size} cover(s)`);
+    }
+  });
+}
+
+function hashFile(filePath, callback) {
+  const hash = crypto.createHash('sha256');
+  fs.createReadStream(filePath)
+    .on('error', callback)
+    .on('data', chunk => hash.update(chunk))
+    .on('end', () => callback(null, hash.digest('hex')));
+}
+
+// Moves an uploaded cover into the store (a rename, not a copy) and returns
+// its hash; a cover that is already stored is just dropped
+function storeCover(uploadPath, callback) {
+  hashFile(uploadPath, (hashError, hash) => {
+    if (hashError) {
+      return callback(hashError);
+    }
+    // A stored cover is handed back in the same tick as the check, so the
+    // callback holds it before a prune can run; the upload goes in the
+    // background
+    const storePath = coverStorePath(hash);
+    if (fs.existsSync(storePath)) {
+      fs.unlink(uploadPath, () => {});
+      return callback(null, hash);
+    }
+    fs.rename(uploadPath, storePath, renameError => {
+      if (renameError) {
+        // Another request may have stored the same content meanwhile
+        fs.unlink(uploadPath, () => {});
+        return callback(fs.existsSync(storePath) ? null : renameError, hash);
+      }
+      callback(null, hash);
+      // The callback holds the new cover first, so this cannot evict it
+      pruneCoverStore();
+    });
+  });
+}
+
 // Configure multer for file uploads
 const storage = multer.diskStorage({
   destination: (req, file, cb) => {
@@ -32,73 +274,116 @@ app.use('/uploads', express.static('uploads'));
 app.use('/output', express.static('output'));
 
 // Create necessary directories
-['uploads', 'output'].forEach(dir => {
+['uploads', 'output', 'logs', COVER_STORE_DIR].forEach(dir => {
   if (!fs.existsSync(dir)) {
     fs.mkdirSync(dir, { recursive: true });
   }
 });
+pruneCoverStore();
+setInterval(pruneCoverStore, COVER_PRUNE_INTERVAL_MS).unref();
+
+// Cover handshake: answers which of the given SHA-256 hashes this client
+// has stored
+app.post('/api/covers/lookup', express.json(), (req, res) => {
+  const client = clientId(req, res);
+  const hashes = req.body && req.body.hashes;
+  if (!Array.isArray(hashes) || hashes.length > 100) {
+    return res.status(400).json({ 
+      success: false, 
+      error: 'Expected a list of at most 100 cover hashes' 
+    });
+  }
+
+  const known = hashes.filter(hash => typeof hash === 'string' && hasCover(client, hash));
+  res.json({ success: true, known: known });
+});
 
-// Encode endpoint
+// Encode endpoint: the cover is either uploaded (coverImage) or referenced
+// by the hash of a stored cover (coverHash + coverName)
 app.post('/api/encode', upload.fields([
   { name: 'coverImage', maxCount: 1 },
   { name: 'secretFile', maxCount: 1 }
 ]), (req, res) => {
   try {
-    if (!req.files['coverImage'] || !req.files['secretFile']) {
+    const files = req.files || {};
+    const client = clientId(req, res);
+    const coverUpload = files['coverImage'] && files['coverImage'][0];
+    const coverHash = String(req.body.coverHash || '');
+    if (!files['secretFile'] || (!coverUpload && !coverHash)) {
+      if (coverUpload) {
+        fs.unlink(coverUpload.path, () => {});
+      }
       return res.status(400).json({ 
         success: false, 
         error: 'Both cover image and secret file are required' 
       });
     }
 
-    const coverImage = req.files['coverImage'][0].path;
-    const secretFile = req.files['secretFile'][0].path;
-    
-    // Get the extension from the cover file to preserve format
-    const coverExtension = path.extname(req.files['coverImage'][0].originalname);
-    const outputImage = `./output/stego-${Date.now()}${coverExtension}`;
-
-    console.log('Encoding files:', { coverImage, secretFile, outputImage });
-
-    // Call your C++ executable
-    // Adjust the command based on your C++ program's interface
-    // Format: stego_cli.exe encode <cover_image> <secret_file> <output_image>
-    const command = `stego_cli.exe encode "${coverImage}" "${secretFile}" "${outputImage}"`;
+    const secretFile = files['secretFile'][0].path;
+    if (!coverUpload && !hasCover(client, coverHash)) {
+      fs.unlink(secretFile, () => {});
+      return res.status(409).json({ 
+        success: false, 
+        coverMissing: true,
+        error: 'Cover is not stored on the server; upload it instead' 
+      });
+    }
 
-    exec(command, (error, stdout, stderr) => {
-      // Clean up uploaded files
-      try {
-        fs.unlinkSync(coverImage);
-        fs.unlinkSync(secretFile);
-      } catch (cleanupError) {
-        console.error('Cleanup error:', cleanupError);
-      }
+    // Get the extension from the cover file to preserve format
+    const coverName = coverUpload ? coverUpload.originalname : String(req.body.coverName || '');
+    const fallback = req.body.fallback === 'append' ? 'append' : 'none';
+    const coverExtension = path.extname(coverName);
+    // Named by job id: engines run in parallel, so timestamps can collide
+    const jobId = nextJobId();
+    const outputImage = `./output/stego-${jobId}${coverExtension}`;
+    const resolveCover = coverUpload
+      ? callback => storeCover(coverUpload.path, callback)
+      : callback => callback(null, coverHash);
 
-      if (error) {
-        console.error(`Encoding error: ${error.message}`);
-        console.error(`stderr: ${stderr}`);
+    resolveCover((storeError, storedHash) => {
+      if (storeError) {
+        fs.unlink(secretFile, () => {});
+        console.error(`Encode job ${jobId} failed: ${storeError.message}`);
         return res.status(500).json({ 
           success: false, 
-          error: 'Encoding failed: ' + (stderr || error.message)
+          error: 'Server error: ' + storeError.message 
         });
       }
 
-      console.log('Encoding successful:', stdout);
+      // Same arguments as: stego_cli.exe encode <cover_image> <secret_file> <output_image>
+      // The engine reads the cover straight from the store
+      grantCover(client, storedHash);
+      const releaseCover = holdCover(storedHash);
+      const coverImage = coverStorePath(storedHash);
+      const job = ['encode', coverImage, secretFile, outputImage, jobId, String(ENCODE_DEADLINE_MS), fallback];
+      runEngineJob(job, (error, outputPath, tradeoffs) => {
+        releaseCover();
+        // Clean up the uploaded secret; stored covers stay for later requests
+        try {
+          fs.unlinkSync(secretFile);
+        } catch (cleanupError) {
+          console.error('Cleanup error:', cleanupError);
+        }
 
-      // Parse the actual output filename from stdout
-      // The C++ program outputs: "Output file: <actual_filename>"
-      let actualFilename = path.basename(outputImage);
-      const match = stdout.match(/Output file:\s*(.+)/i);
-      if (match && match[1]) {
-        const outputPath = match[1].trim();
-        actualFilename = path.basename(outputPath);
-      }
+        if (error) {
+          console.error(`Encode job ${jobId} failed: ${error.message}`);
+          return res.status(500).json({ 
+            success: false, 
+            error: 'Encoding failed: ' + error.message
+          });
+        }
 
-      res.json({
-        success: true,
-        message: 'File encoded successfully',
-        outputFile: '/output/' + actualFilename,
-        filename: actualFilename
+        // The engine may add the cover's extension to the requested name
+        const actualFilename = path.basename(outputPath);
+        console.log(`Encode job ${jobId} done: ${actualFilename}` + (tradeoffs ? ` (${tradeoffs})` : ''));
+
+        res.json({
+          success: true,
+          message: tradeoffs ? `File encoded successfully. Traded off: ${tradeoffs}` : 'File encoded successfully',
+          tradeoffs: tradeoffs,
+          outputFile: '/output/' + actualFilename,
+          filename: actualFilename
+        });
       });
     });
   } catch (error) {
@@ -121,16 +406,12 @@ app.post('/api/decode', upload.single('stegoImage'), (req, res) => {
     }
 
     const stegoImage = req.file.path;
+    const jobId = nextJobId();
     // Don't specify extension - let C++ program determine it from header
-    const outputFile = `./output/extracted-${Date.now()}`;
-
-    console.log('Decoding file:', { stegoImage, outputFile });
+    const outputFile = `./output/extracted-${jobId}`;
 
-    // Call your C++ executable
-    // Format: stego_cli.exe decode <stego_image> <output_file>
-    const command = `stego_cli.exe decode "${stegoImage}" "${outputFile}"`;
-
-    exec(command, (error, stdout, stderr) => {
+    // Same arguments as: stego_cli.exe decode <stego_image> <output_file>
+    runEngineJob(['decode', stegoImage, outputFile, jobId], (error, extractedPath) => {
       // Clean up uploaded file
       try {
         fs.unlinkSync(stegoImage);
@@ -139,37 +420,16 @@ app.post('/api/decode', upload.single('stegoImage'), (req, res) => {
       }
 
       if (error) {
-        console.error(`Decoding error: ${error.message}`);
-        console.error(`stderr: ${stderr}`);
+        console.error(`Decode job ${jobId} failed: ${error.message}`);
         return res.status(500).json({ 
           success: false, 
-          error: 'Decoding failed: ' + (stderr || error.message)
+          error: 'Decoding failed: ' + error.message
         });
       }
 
-      console.log('Decoding successful:', stdout);
-
-      // Parse the actual output filename from stdout
-      // The C++ program outputs: "Extracted file: <actual_filename>"
-      let actualFilename = path.basename(outputFile);
-      const match = stdout.match(/Extracted file:\s*(.+)/i);
-      if (match && match[1]) {
-        const extractedPath = match[1].trim();
-        actualFilename = path.basename(extractedPath);
-      } else {
-        // Fallback: scan output directory for files matching the pattern
-        const outputDir = path.dirname(outputFile);
-        const baseFilename = path.basename(outputFile);
-        try {
-          const files = fs.readdirSync(outputDir);
-          const matchingFile = files.find(f => f.startsWith(baseFilename));
-          if (matchingFile) {
-            actualFilename = matchingFile;
-          }
-        } catch (scanError) {
-          console.error('Error scanning output directory:', scanError);
-        }
-      }
+      // The extension comes from the filename stored in the hidden header
+      const actualFilename = path.basename(extractedPath);
+      console.log(`Decode job ${jobId} done: ${actualFilename}`);
 
       res.json({
         success: true,
@@ -199,6 +459,11 @@ app.get('/api/download/:filename', (req, res) => {
   }
 });
 
+if (!fs.existsSync(ENGINE_PATH)) {
+  console.error(`Engine not found: ${ENGINE_PATH}. Build it with: ` +
+    'g++ -O2 -o stego_cli.exe stego_cli.cpp -std=c++11 -pthread');
+}
+
 app.listen(PORT, () => {
     console.log(`Server is running on http://localhost:${PORT}`);
 });
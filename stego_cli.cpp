@@ -7,7 +7,62 @@
 #include <algorithm>
 #include <iomanip>
 #include <sstream>
+#include <map>
+#include <random>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <memory>
+#include <functional>
 #include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#include <io.h>
+#else
+#include <dirent.h>
+#endif
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <sys/ioctl.h>
+#include <sys/uio.h>
+#include <linux/fs.h>
+#ifndef FICLONE
+#define FICLONE _IOW(0x94, 9, int)
+#endif
+#endif
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#include <cpuid.h>
+#define STEGO_HAVE_X86_SIMD 1
+#define STEGO_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+// USDT (SystemTap SDT) probes: a single nop per site when nothing is attached.
+// Built in when <sys/sdt.h> is present (systemtap-sdt-dev / systemtap-sdt-devel);
+// list them with `bpftrace -l 'usdt:./stego:*'`.
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define STEGO_HAVE_SDT 1
+#endif
+#endif
+
+#ifdef STEGO_HAVE_SDT
+#define STEGO_PROBE1(name, a) DTRACE_PROBE1(stego, name, a)
+#define STEGO_PROBE2(name, a, b) DTRACE_PROBE2(stego, name, a, b)
+#define STEGO_PROBE3(name, a, b, c) DTRACE_PROBE3(stego, name, a, b, c)
+#else
+#define STEGO_PROBE1(name, a) ((void)sizeof(a))
+#define STEGO_PROBE2(name, a, b) ((void)sizeof(a), (void)sizeof(b))
+#define STEGO_PROBE3(name, a, b, c) ((void)sizeof(a), (void)sizeof(b), (void)sizeof(c))
+#endif
 
 using namespace std;
 
@@ -21,6 +76,51 @@ namespace Config
     const uint32_t MAGIC_SIGNATURE = 0x5354454E;
     const uint16_t VERSION = 0x0001;
     const size_t MAX_FILENAME_LENGTH = 256;
+    const uint32_t EXTENSION_MAGIC = 0x53455854;
+    const uint16_t EXT_SIGNATURE = 0x0001;
+    const uint16_t EXT_SHA256 = 0x0002;
+    const size_t VERIFY_BATCH_SIZE = 64;
+    const size_t DIGEST_BATCH_MAX_PAYLOAD = 64 * 1024;
+    const size_t SHA256_LANE_MAX_MESSAGE = 256;
+    const uint32_t JOB_LOG_MAGIC = 0x534A4C52;
+    const size_t JOB_LOG_RING_SIZE = 1024;
+    const size_t JOB_LOG_RING_HIGH_WATER = JOB_LOG_RING_SIZE / 2;
+    const size_t JOB_LOG_MAX_BYTES = 8 * 1024 * 1024;
+    const size_t JOB_LOG_KEEP_FILES = 4;
+    const int JOB_LOG_DRAIN_MS = 20;
+    const size_t COPY_BUFFER_SIZE = 1024 * 1024;
+    const size_t QOI_HEADER_SIZE = 14;
+    const size_t QOI_IO_BUFFER_SIZE = 256 * 1024;
+    const size_t QOI_TILE_PIXELS = 4096;
+    const uint64_t QOI_MAX_PIXELS = 400000000;
+    const unsigned char QOI_OP_INDEX = 0x00;
+    const unsigned char QOI_OP_DIFF = 0x40;
+    const unsigned char QOI_OP_LUMA = 0x80;
+    const unsigned char QOI_OP_RUN = 0xc0;
+    const unsigned char QOI_OP_RGB = 0xfe;
+    const unsigned char QOI_OP_RGBA = 0xff;
+    const uint32_t EXR_MAGIC = 0x01312f76;
+    const int FLOAT32_EMBED_BITS = 4;
+    const int HALF_EMBED_BITS = 1;
+    const size_t EXR_HEADER_WINDOW = 64 * 1024;
+    const size_t DICOM_PREAMBLE_SIZE = 128;
+    const size_t DICOM_IO_BUFFER_SIZE = 256 * 1024;
+    const size_t DICOM_TILE_SAMPLES = 8192;
+    const size_t FAST_PATH_MAX_PAYLOAD = 64 * 1024;
+    const size_t FAST_PATH_MAX_PATH = 4096;
+    const size_t FAST_PATH_COPY_BUFFER = 64 * 1024;
+    const int BENCH_ITERATIONS = 200;
+    const size_t BENCH_COVER_SIZE = 2 * 1024 * 1024;
+    const size_t BENCH_SMALL_COVER_SIZE = 16 * 1024;
+    const int CALIBRATION_ITERATIONS = 15;
+    const size_t CALIBRATION_SMALL_COVER = 256 * 1024;
+    const size_t CALIBRATION_SMALL_PAYLOAD = 512;
+    const size_t CALIBRATION_LARGE_PAYLOAD = 8 * 1024;
+    const uint32_t STORE_INDEX_MAGIC = 0x53494458;
+    const uint32_t STORE_EXTENT_MAGIC = 0x534F424A;
+    const size_t STORE_IO_THREADS = 8;
+    const size_t STORE_ROOT_COVERS = 8;
+    const size_t STORE_INDEX_WINDOW = 256 * 1024;
 }
 
 // ============================================================================
@@ -35,13 +135,71 @@ namespace Utils
         return rc == 0 ? stat_buf.st_size : 0;
     }
 
+    bool sameFile(const string &a, const string &b)
+    {
+        struct stat statA, statB;
+        if (stat(a.c_str(), &statA) != 0 || stat(b.c_str(), &statB) != 0)
+        {
+            return false;
+        }
+        if (statA.st_ino == 0)
+        {
+            return a == b;
+        }
+        return statA.st_dev == statB.st_dev && statA.st_ino == statB.st_ino;
+    }
+
     bool fileExists(const string &filename)
     {
         ifstream file(filename, ios::binary);
         return file.good();
     }
 
-    string formatBytes(size_t bytes)
+    void ensureDirectory(const string &path)
+    {
+#ifdef _WIN32
+        _mkdir(path.c_str());
+#else
+        mkdir(path.c_str(), 0755);
+#endif
+    }
+
+    // Names of the regular, non-hidden files in a directory, sorted
+    vector<string> listFiles(const string &directory)
+    {
+        vector<string> names;
+#ifdef _WIN32
+        struct _finddata_t entry;
+        intptr_t handle = _findfirst((directory + "\\*").c_str(), &entry);
+        if (handle != -1)
+        {
+            do
+            {
+                if (!(entry.attrib & _A_SUBDIR) && entry.name[0] != '.')
+                    names.push_back(entry.name);
+            } while (_findnext(handle, &entry) == 0);
+            _findclose(handle);
+        }
+#else
+        DIR *dir = opendir(directory.c_str());
+        if (dir != NULL)
+        {
+            while (struct dirent *entry = readdir(dir))
+            {
+                struct stat info;
+                string path = directory + "/" + entry->d_name;
+                if (entry->d_name[0] != '.' && stat(path.c_str(), &info) == 0 && S_ISREG(info.st_mode))
+                    names.push_back(entry->d_name);
+            }
+            closedir(dir);
+        }
+#endif
+        sort(names.begin(), names.end());
+        return names;
+    }
+
+    // Into a caller's buffer, for paths that avoid the heap
+    void formatBytes(size_t bytes, char *out, size_t capacity)
     {
         const char *units[] = {"B", "KB", "MB", "GB", "TB"};
         int unitIndex = 0;
@@ -53,9 +211,58 @@ namespace Utils
             unitIndex++;
         }
 
-        ostringstream oss;
-        oss << fixed << setprecision(2) << size << " " << units[unitIndex];
-        return oss.str();
+        snprintf(out, capacity, "%.2f %s", size, units[unitIndex]);
+    }
+
+    string formatBytes(size_t bytes)
+    {
+        char text[32];
+        formatBytes(bytes, text, sizeof(text));
+        return text;
+    }
+
+    // Writes 2 * length digits and a terminating NUL
+    void toHex(const unsigned char *data, size_t length, char *out)
+    {
+        static const char digits[] = "0123456789abcdef";
+        for (size_t i = 0; i < length; i++)
+        {
+            out[i * 2] = digits[data[i] >> 4];
+            out[i * 2 + 1] = digits[data[i] & 15];
+        }
+        out[length * 2] = '\0';
+    }
+
+    string toHex(const unsigned char *data, size_t length)
+    {
+        string out(length * 2 + 1, '\0');
+        toHex(data, length, &out[0]);
+        out.resize(length * 2);
+        return out;
+    }
+
+    vector<unsigned char> fromHex(const string &hex)
+    {
+        vector<unsigned char> out(hex.size() / 2);
+        for (size_t i = 0; i < out.size(); i++)
+        {
+            out[i] = static_cast<unsigned char>(strtoul(hex.substr(i * 2, 2).c_str(), NULL, 16));
+        }
+        return out;
+    }
+
+    // Start of the file name within a path
+    const char *filenamePart(const char *path)
+    {
+        const char *name = path;
+        for (const char *p = path; *p != '\0'; p++)
+        {
+            if (*p == '/' || *p == '\\')
+            {
+                name = p + 1;
+            }
+        }
+        return name;
     }
 
     string extractFilename(const string &fullPath)
@@ -103,6 +310,32 @@ namespace Utils
             return userProvidedPath + originalExt;
         }
     }
+
+    // generateOutputFilename for a non-empty path, into a caller's buffer;
+    // false when the result does not fit
+    bool composeOutputFilename(const char *userProvidedPath, const char *originalFilename, char *out,
+                               size_t capacity)
+    {
+        size_t length = strlen(userProvidedPath);
+        const char *extension = "";
+        if (strchr(filenamePart(userProvidedPath), '.') == NULL)
+        {
+            const char *dot = strrchr(originalFilename, '.');
+            extension = dot == NULL ? "" : dot;
+        }
+        size_t extensionLength = strlen(extension);
+        if (length == 0 || length + extensionLength >= capacity)
+        {
+            return false;
+        }
+        memcpy(out, userProvidedPath, length);
+        for (size_t i = 0; i < extensionLength; i++)
+        {
+            out[length + i] = static_cast<char>(tolower(static_cast<unsigned char>(extension[i])));
+        }
+        out[length + extensionLength] = '\0';
+        return true;
+    }
 }
 
 // ============================================================================
@@ -133,364 +366,7465 @@ public:
 };
 
 // ============================================================================
-// FILE HEADER STRUCTURE
+// BINARY JOB LOG
 // ============================================================================
-struct StegoHeader
+// Fixed-size records written by producers into per-thread single-producer
+// rings without locks; a background thread drains them into
+// <dir>/stego-jobs.bin, rotating to stego-jobs.<n>.bin. When a ring is full
+// the record is dropped and counted rather than stalling the job.
+enum JobLogEvent
+{
+    JOBLOG_JOB_START = 1,
+    JOBLOG_PHASE = 2,
+    JOBLOG_JOB_END = 3,
+    JOBLOG_DROPPED = 4
+};
+
+struct JobLogRecord
 {
     uint32_t magic;
-    uint16_t version;
-    uint32_t hiddenFileSize;
-    uint16_t filenameLength;
-    char filename[Config::MAX_FILENAME_LENGTH];
-    uint32_t checksum;
+    uint16_t event;
+    uint16_t phase;
+    uint64_t jobId;
+    uint64_t timestampNs;
+    uint64_t durationNs;
+    uint64_t bytes;
+    int32_t status;
+    uint32_t thread;
+    char mode[8];
+    char name[16];
+};
 
-    StegoHeader() : magic(Config::MAGIC_SIGNATURE),
-                    version(Config::VERSION),
-                    hiddenFileSize(0),
-                    filenameLength(0),
-                    checksum(0)
+class JobLog
+{
+private:
+    struct Ring
     {
-        memset(filename, 0, Config::MAX_FILENAME_LENGTH);
+        JobLogRecord slots[Config::JOB_LOG_RING_SIZE];
+        atomic<uint64_t> head;
+        atomic<uint64_t> tail;
+        atomic<uint64_t> dropped;
+        uint32_t thread;
+
+        explicit Ring(uint32_t id) : head(0), tail(0), dropped(0), thread(id) {}
+    };
+
+    atomic<bool> enabled;
+    bool stopping;
+    bool drainRequested;
+    string directory;
+    uint64_t jobId;
+    mutex ringsMutex;
+    vector<unique_ptr<Ring> > rings;
+    mutex wakeMutex;
+    condition_variable wake;
+    thread drainThread;
+
+    JobLog() : enabled(false), stopping(false), drainRequested(false), jobId(0) {}
+
+    static JobLog &instance()
+    {
+        static JobLog log;
+        return log;
     }
 
-    uint32_t calculateChecksum() const
+    Ring *threadRing()
     {
-        uint32_t sum = magic + version + hiddenFileSize + filenameLength;
-        for (size_t i = 0; i < filenameLength && i < Config::MAX_FILENAME_LENGTH; i++)
+        static thread_local Ring *ring = NULL;
+        if (ring == NULL)
         {
-            sum += static_cast<unsigned char>(filename[i]);
+            lock_guard<mutex> lock(ringsMutex);
+            rings.push_back(unique_ptr<Ring>(new Ring(static_cast<uint32_t>(rings.size()))));
+            ring = rings.back().get();
         }
-        return sum;
+        return ring;
     }
 
-    bool validate() const
+    static uint64_t nowNs()
     {
-        return magic == Config::MAGIC_SIGNATURE && checksum == calculateChecksum();
+        return static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(
+                                         chrono::system_clock::now().time_since_epoch())
+                                         .count());
     }
-};
 
-// ============================================================================
-// FILE VALIDATOR CLASS
-// ============================================================================
-class FileValidator
-{
-public:
-    static void validateFileAccess(const string &filename, const string &fileType)
+    string logPath(int index) const
     {
-        if (filename.empty())
+        if (index == 0)
         {
-            throw FileAccessException(fileType + " path cannot be empty");
+            return directory + "/stego-jobs.bin";
         }
+        return directory + "/stego-jobs." + to_string(index) + ".bin";
+    }
 
-        if (!Utils::fileExists(filename))
+    void rotateIfNeeded()
+    {
+        if (Utils::getFileSize(logPath(0)) < Config::JOB_LOG_MAX_BYTES)
         {
-            throw FileAccessException(fileType + " not found or not accessible: " + filename);
+            return;
+        }
+        remove(logPath(Config::JOB_LOG_KEEP_FILES).c_str());
+        for (int i = static_cast<int>(Config::JOB_LOG_KEEP_FILES) - 1; i >= 0; i--)
+        {
+            rename(logPath(i).c_str(), logPath(i + 1).c_str());
         }
     }
 
-    static size_t validateAndCalculateMaxSize(size_t hiddenSize, size_t hostSize)
+    void drain()
     {
-        // Check minimum host size
-        if (hostSize < Config::MIN_HOST_SIZE)
+        vector<JobLogRecord> pending;
         {
-            throw FileSizeException(
-                "Host file too small. Minimum size: " +
-                Utils::formatBytes(Config::MIN_HOST_SIZE));
+            lock_guard<mutex> lock(ringsMutex);
+            for (size_t r = 0; r < rings.size(); r++)
+            {
+                Ring &ring = *rings[r];
+                uint64_t tail = ring.tail.load(memory_order_relaxed);
+                uint64_t head = ring.head.load(memory_order_acquire);
+                for (; tail != head; tail++)
+                {
+                    pending.push_back(ring.slots[tail % Config::JOB_LOG_RING_SIZE]);
+                }
+                ring.tail.store(tail, memory_order_release);
+
+                uint64_t dropped = ring.dropped.exchange(0, memory_order_relaxed);
+                if (dropped > 0)
+                {
+                    JobLogRecord record = makeRecord(JOBLOG_DROPPED, "joblog", 0, "", 0, dropped, 0);
+                    record.thread = ring.thread;
+                    pending.push_back(record);
+                }
+            }
+        }
+        if (pending.empty())
+        {
+            return;
         }
 
-        // Calculate maximum allowed hidden size
-        size_t maxHiddenSize = static_cast<size_t>(
-            hostSize * Config::MAX_HIDDEN_SIZE_RATIO);
+        // Logging failures must never fail a job
+        rotateIfNeeded();
+        ofstream file(logPath(0), ios::binary | ios::app);
+        if (file.is_open())
+        {
+            file.write(reinterpret_cast<const char *>(pending.data()), pending.size() * sizeof(JobLogRecord));
+        }
+    }
 
-        // Account for header size
-        size_t headerSize = sizeof(StegoHeader);
-        if (maxHiddenSize < headerSize)
+    void drainLoop()
+    {
+        unique_lock<mutex> lock(wakeMutex);
+        while (!stopping)
         {
-            throw FileSizeException("Host file too small to hide any data");
+            wake.wait_for(lock, chrono::milliseconds(Config::JOB_LOG_DRAIN_MS),
+                          [this]() { return stopping || drainRequested; });
+            drainRequested = false;
+            lock.unlock();
+            drain();
+            lock.lock();
         }
+    }
 
-        maxHiddenSize -= headerSize;
+    JobLogRecord makeRecord(uint16_t event, const char *mode, uint16_t phase, const char *name,
+                            int32_t status, uint64_t bytes, uint64_t durationNs) const
+    {
+        JobLogRecord record;
+        memset(&record, 0, sizeof(record));
+        record.magic = Config::JOB_LOG_MAGIC;
+        record.event = event;
+        record.phase = phase;
+        record.jobId = jobId;
+        record.timestampNs = nowNs();
+        record.durationNs = durationNs;
+        record.bytes = bytes;
+        record.status = status;
+        strncpy(record.mode, mode, sizeof(record.mode) - 1);
+        strncpy(record.name, name, sizeof(record.name) - 1);
+        return record;
+    }
 
-        // Check if hidden file fits
-        if (hiddenSize > maxHiddenSize)
+    static string jsonString(const char *text, size_t maxLength)
+    {
+        string out = "\"";
+        for (size_t i = 0; i < maxLength && text[i] != '\0'; i++)
         {
-            throw FileSizeException(
-                "The file to hide exceeds the allowable size.\n" +
-                string("  File size: ") + Utils::formatBytes(hiddenSize) + "\n" +
-                string("  Maximum allowed: ") + Utils::formatBytes(maxHiddenSize) + "\n" +
-                string("  Please choose a smaller file or a larger host file."));
+            unsigned char c = static_cast<unsigned char>(text[i]);
+            if (c == '"' || c == '\\')
+            {
+                out += '\\';
+                out += static_cast<char>(c);
+            }
+            else if (c < 0x20)
+            {
+                out += "?";
+            }
+            else
+            {
+                out += static_cast<char>(c);
+            }
         }
-
-        return maxHiddenSize;
+        return out + "\"";
     }
-};
 
-// ============================================================================
-// FILE IO MANAGER CLASS
-// ============================================================================
-class FileIOManager
-{
 public:
-    static vector<unsigned char> readFile(const string &filename)
+    static void start(const string &logDirectory, uint64_t id)
     {
-        ifstream file(filename, ios::binary);
-        if (!file.is_open())
+        JobLog &log = instance();
+        Utils::ensureDirectory(logDirectory);
+        log.directory = logDirectory;
+        log.jobId = id;
+        log.stopping = false;
+        log.enabled.store(true, memory_order_release);
+        log.drainThread = thread(&JobLog::drainLoop, &log);
+    }
+
+    // Parses a hex job id; an empty one gets a fresh random id
+    static uint64_t makeJobId(const string &text)
+    {
+        if (!text.empty())
         {
-            throw FileAccessException("Cannot open file for reading: " + filename);
+            return strtoull(text.c_str(), NULL, 16);
         }
+        random_device rng;
+        return (static_cast<uint64_t>(rng()) << 32) | rng();
+    }
 
-        // Get file size
-        file.seekg(0, ios::end);
-        size_t size = file.tellg();
-        file.seekg(0, ios::beg);
+    // Jobs that share one process (daemon mode) run one at a time, so the
+    // id is switched between jobs on the recording thread
+    static void setJobId(uint64_t id)
+    {
+        instance().jobId = id;
+    }
 
-        // Read file data
-        vector<unsigned char> data(size);
-        file.read(reinterpret_cast<char *>(data.data()), size);
+    // Drains everything still queued; call once before the process exits
+    static void stop()
+    {
+        JobLog &log = instance();
+        if (!log.enabled.load(memory_order_acquire))
+        {
+            return;
+        }
+        {
+            lock_guard<mutex> lock(log.wakeMutex);
+            log.stopping = true;
+        }
+        log.wake.notify_one();
+        log.drainThread.join();
+        log.enabled.store(false, memory_order_release);
+        log.drain();
+    }
 
-        if (!file)
+    static void record(uint16_t event, const char *mode, uint16_t phase, const char *name,
+                       int32_t status, uint64_t bytes, uint64_t durationNs)
+    {
+        JobLog &log = instance();
+        if (!log.enabled.load(memory_order_relaxed))
         {
-            throw FileAccessException("Error reading file: " + filename);
+            return;
         }
 
-        file.close();
-        return data;
+        Ring *ring = log.threadRing();
+        uint64_t head = ring->head.load(memory_order_relaxed);
+        if (head - ring->tail.load(memory_order_acquire) >= Config::JOB_LOG_RING_SIZE)
+        {
+            ring->dropped.fetch_add(1, memory_order_relaxed);
+            return;
+        }
+        JobLogRecord &slot = ring->slots[head % Config::JOB_LOG_RING_SIZE];
+        slot = log.makeRecord(event, mode, phase, name, status, bytes, durationNs);
+        slot.thread = ring->thread;
+        ring->head.store(head + 1, memory_order_release);
+
+        // Bursts of short jobs fill a ring faster than the drain interval, so
+        // the drain thread is woken once the ring is half full
+        if (head + 1 - ring->tail.load(memory_order_acquire) == Config::JOB_LOG_RING_HIGH_WATER)
+        {
+            {
+                lock_guard<mutex> lock(log.wakeMutex);
+                log.drainRequested = true;
+            }
+            log.wake.notify_one();
+        }
     }
 
-    static void writeFile(const string &filename, const vector<unsigned char> &data)
+    // Decodes log files into one JSON object per line
+    static void dump(const string &filename, ostream &out)
     {
-        ofstream file(filename, ios::binary);
+        static const char *events[] = {"unknown", "job_start", "phase", "job_end", "dropped"};
+        ifstream file(filename, ios::binary);
         if (!file.is_open())
         {
-            throw FileAccessException("Cannot create output file: " + filename);
+            throw FileAccessException("Cannot open file for reading: " + filename);
         }
 
-        file.write(reinterpret_cast<const char *>(data.data()), data.size());
+        JobLogRecord record;
+        while (file.read(reinterpret_cast<char *>(&record), sizeof(record)))
+        {
+            if (record.magic != Config::JOB_LOG_MAGIC)
+            {
+                throw InvalidFormatException("Corrupted job log record in " + filename);
+            }
+            const char *event = record.event <= JOBLOG_DROPPED ? events[record.event] : events[0];
+            char jobHex[17];
+            snprintf(jobHex, sizeof(jobHex), "%016llx", static_cast<unsigned long long>(record.jobId));
 
-        if (!file)
+            out << "{\"ts_ns\":" << record.timestampNs
+                << ",\"job\":\"" << jobHex << "\""
+                << ",\"event\":\"" << event << "\""
+                << ",\"mode\":" << jsonString(record.mode, sizeof(record.mode))
+                << ",\"phase\":" << record.phase
+                << ",\"name\":" << jsonString(record.name, sizeof(record.name))
+                << ",\"status\":" << record.status
+                << ",\"bytes\":" << record.bytes
+                << ",\"duration_ns\":" << record.durationNs
+                << ",\"thread\":" << record.thread << "}\n";
+        }
+    }
+};
+
+// Starts the job log for the lifetime of main() when --joblog is given
+class JobLogSession
+{
+private:
+    bool active;
+
+public:
+    JobLogSession(const string &directory, const string &jobId) : active(!directory.empty())
+    {
+        if (!active)
         {
-            throw FileAccessException("Error writing to file: " + filename);
+            return;
         }
+        JobLog::start(directory, JobLog::makeJobId(jobId));
+    }
 
-        file.close();
+    ~JobLogSession()
+    {
+        if (active)
+        {
+            JobLog::stop();
+        }
     }
 };
 
 // ============================================================================
-// STEGANOGRAPHY ENGINE CLASS
+// TRACE PROBES
 // ============================================================================
-class UniversalSteganography
+// Probes (provider "stego"):
+//   job_start(mode, path)            job_end(mode, status, bytes)
+//   phase(mode, index, name)         header_candidate(offset, valid)
+//   queue_push(path, depth)          queue_flush(depth)
+//   chunk_done(kind, count, ok)
+// chunk_done kinds: qoi_tile, float_block, dicom_chunk (count in samples or
+// pixels), sqlite_page, copy_range, stream_copy (count in bytes) and
+// digest_batch, signature_batch (count in files).
+// status is 0 on success and -1 when the job ends with an exception.
+// JobProbe also feeds the same job events into the binary job log.
+class JobProbe
 {
 private:
-    string hiddenFilePath;
-    string hostFilePath;
-    string outputFilePath;
+    const char *mode;
+    int status;
+    uint64_t bytes;
+    chrono::steady_clock::time_point started;
 
-    StegoHeader createHeader(const string &hiddenFilename, size_t hiddenSize)
+    uint64_t elapsedNs() const
     {
-        StegoHeader header;
-        header.hiddenFileSize = static_cast<uint32_t>(hiddenSize);
-
-        string filename = Utils::extractFilename(hiddenFilename);
-        header.filenameLength = min(filename.length(),
-                                    static_cast<size_t>(Config::MAX_FILENAME_LENGTH - 1));
-
-        strncpy(header.filename, filename.c_str(), header.filenameLength);
-        header.filename[header.filenameLength] = '\0';
-
-        header.checksum = header.calculateChecksum();
-        return header;
+        return static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(
+                                         chrono::steady_clock::now() - started)
+                                         .count());
     }
 
-    vector<unsigned char> serializeHeader(const StegoHeader &header)
+public:
+    JobProbe(const char *jobMode, const string &path,
+             chrono::steady_clock::time_point jobStarted = chrono::steady_clock::now())
+        : mode(jobMode), status(-1), bytes(0), started(jobStarted)
     {
-        vector<unsigned char> buffer(sizeof(StegoHeader));
-        memcpy(buffer.data(), &header, sizeof(StegoHeader));
-        return buffer;
+        STEGO_PROBE2(job_start, mode, path.c_str());
+        JobLog::record(JOBLOG_JOB_START, mode, 0, "", 0, 0, 0);
     }
 
-    StegoHeader deserializeHeader(const vector<unsigned char> &buffer)
+    void phase(int index, const char *name)
     {
-        if (buffer.size() < sizeof(StegoHeader))
-        {
-            throw InvalidFormatException("Invalid header size");
-        }
-
-        StegoHeader header;
-        memcpy(&header, buffer.data(), sizeof(StegoHeader));
-        return header;
+        STEGO_PROBE3(phase, mode, index, name);
+        JobLog::record(JOBLOG_PHASE, mode, static_cast<uint16_t>(index), name, 0, 0, elapsedNs());
     }
 
-public:
-    UniversalSteganography(const string &hiddenFile,
-                           const string &hostFile,
-                           const string &outputFile)
-        : hiddenFilePath(hiddenFile),
-          hostFilePath(hostFile),
-          outputFilePath(outputFile) {}
-
-    void hideFile()
+    void complete(uint64_t processedBytes)
     {
-        cout << "\n━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━" << endl;
-        cout << "  INITIATING FILE HIDING PROCESS" << endl;
-        cout << "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n"
-             << endl;
+        status = 0;
+        bytes = processedBytes;
+    }
 
-        // Step 1: Validate file access
-        cout << "[1/5] Validating file access..." << endl;
-        FileValidator::validateFileAccess(hiddenFilePath, "File to hide");
-        FileValidator::validateFileAccess(hostFilePath, "Host file");
-        cout << "      ✓ Files validated successfully\n"
-             << endl;
+    ~JobProbe()
+    {
+        STEGO_PROBE3(job_end, mode, status, bytes);
+        JobLog::record(JOBLOG_JOB_END, mode, 0, "", status, bytes, elapsedNs());
+    }
+};
+
+// ============================================================================
+// FILE HEADER STRUCTURE
+// ============================================================================
+struct StegoHeader
+{
+    uint32_t magic;
+    uint16_t version;
+    uint32_t hiddenFileSize;
+    uint16_t filenameLength;
+    char filename[Config::MAX_FILENAME_LENGTH];
+    uint32_t checksum;
+
+    StegoHeader() : magic(Config::MAGIC_SIGNATURE),
+                    version(Config::VERSION),
+                    hiddenFileSize(0),
+                    filenameLength(0),
+                    checksum(0)
+    {
+        memset(filename, 0, Config::MAX_FILENAME_LENGTH);
+    }
+
+    uint32_t calculateChecksum() const
+    {
+        uint32_t sum = magic + version + hiddenFileSize + filenameLength;
+        for (size_t i = 0; i < filenameLength && i < Config::MAX_FILENAME_LENGTH; i++)
+        {
+            sum += static_cast<unsigned char>(filename[i]);
+        }
+        return sum;
+    }
+
+    bool validate() const
+    {
+        return magic == Config::MAGIC_SIGNATURE && checksum == calculateChecksum();
+    }
+};
+
+// ============================================================================
+// SHA-512 HASH
+// ============================================================================
+class Sha512
+{
+private:
+    uint64_t state[8];
+    unsigned char buffer[128];
+    size_t bufferLength;
+    uint64_t totalLength;
+
+    static uint64_t rotr(uint64_t x, int n)
+    {
+        return (x >> n) | (x << (64 - n));
+    }
+
+    void compress(const unsigned char *block)
+    {
+        static const uint64_t K[80] = {
+            0x428a2f98d728ae22ULL, 0x7137449123ef65cdULL, 0xb5c0fbcfec4d3b2fULL, 0xe9b5dba58189dbbcULL,
+            0x3956c25bf348b538ULL, 0x59f111f1b605d019ULL, 0x923f82a4af194f9bULL, 0xab1c5ed5da6d8118ULL,
+            0xd807aa98a3030242ULL, 0x12835b0145706fbeULL, 0x243185be4ee4b28cULL, 0x550c7dc3d5ffb4e2ULL,
+            0x72be5d74f27b896fULL, 0x80deb1fe3b1696b1ULL, 0x9bdc06a725c71235ULL, 0xc19bf174cf692694ULL,
+            0xe49b69c19ef14ad2ULL, 0xefbe4786384f25e3ULL, 0x0fc19dc68b8cd5b5ULL, 0x240ca1cc77ac9c65ULL,
+            0x2de92c6f592b0275ULL, 0x4a7484aa6ea6e483ULL, 0x5cb0a9dcbd41fbd4ULL, 0x76f988da831153b5ULL,
+            0x983e5152ee66dfabULL, 0xa831c66d2db43210ULL, 0xb00327c898fb213fULL, 0xbf597fc7beef0ee4ULL,
+            0xc6e00bf33da88fc2ULL, 0xd5a79147930aa725ULL, 0x06ca6351e003826fULL, 0x142929670a0e6e70ULL,
+            0x27b70a8546d22ffcULL, 0x2e1b21385c26c926ULL, 0x4d2c6dfc5ac42aedULL, 0x53380d139d95b3dfULL,
+            0x650a73548baf63deULL, 0x766a0abb3c77b2a8ULL, 0x81c2c92e47edaee6ULL, 0x92722c851482353bULL,
+            0xa2bfe8a14cf10364ULL, 0xa81a664bbc423001ULL, 0xc24b8b70d0f89791ULL, 0xc76c51a30654be30ULL,
+            0xd192e819d6ef5218ULL, 0xd69906245565a910ULL, 0xf40e35855771202aULL, 0x106aa07032bbd1b8ULL,
+            0x19a4c116b8d2d0c8ULL, 0x1e376c085141ab53ULL, 0x2748774cdf8eeb99ULL, 0x34b0bcb5e19b48a8ULL,
+            0x391c0cb3c5c95a63ULL, 0x4ed8aa4ae3418acbULL, 0x5b9cca4f7763e373ULL, 0x682e6ff3d6b2b8a3ULL,
+            0x748f82ee5defb2fcULL, 0x78a5636f43172f60ULL, 0x84c87814a1f0ab72ULL, 0x8cc702081a6439ecULL,
+            0x90befffa23631e28ULL, 0xa4506cebde82bde9ULL, 0xbef9a3f7b2c67915ULL, 0xc67178f2e372532bULL,
+            0xca273eceea26619cULL, 0xd186b8c721c0c207ULL, 0xeada7dd6cde0eb1eULL, 0xf57d4f7fee6ed178ULL,
+            0x06f067aa72176fbaULL, 0x0a637dc5a2c898a6ULL, 0x113f9804bef90daeULL, 0x1b710b35131c471bULL,
+            0x28db77f523047d84ULL, 0x32caab7b40c72493ULL, 0x3c9ebe0a15c9bebcULL, 0x431d67c49c100d4cULL,
+            0x4cc5d4becb3e42b6ULL, 0x597f299cfc657e2aULL, 0x5fcb6fab3ad6faecULL, 0x6c44198c4a475817ULL};
+
+        uint64_t w[80];
+        for (int i = 0; i < 16; i++)
+        {
+            w[i] = 0;
+            for (int j = 0; j < 8; j++)
+            {
+                w[i] = (w[i] << 8) | block[i * 8 + j];
+            }
+        }
+        for (int i = 16; i < 80; i++)
+        {
+            uint64_t s0 = rotr(w[i - 15], 1) ^ rotr(w[i - 15], 8) ^ (w[i - 15] >> 7);
+            uint64_t s1 = rotr(w[i - 2], 19) ^ rotr(w[i - 2], 61) ^ (w[i - 2] >> 6);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+
+        uint64_t a = state[0], b = state[1], c = state[2], d = state[3];
+        uint64_t e = state[4], f = state[5], g = state[6], h = state[7];
+        for (int i = 0; i < 80; i++)
+        {
+            uint64_t t1 = h + (rotr(e, 14) ^ rotr(e, 18) ^ rotr(e, 41)) + ((e & f) ^ (~e & g)) + K[i] + w[i];
+            uint64_t t2 = (rotr(a, 28) ^ rotr(a, 34) ^ rotr(a, 39)) + ((a & b) ^ (a & c) ^ (b & c));
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+        state[5] += f;
+        state[6] += g;
+        state[7] += h;
+    }
+
+public:
+    static const size_t DIGEST_SIZE = 64;
+
+    Sha512() { reset(); }
+
+    void reset()
+    {
+        static const uint64_t IV[8] = {
+            0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL, 0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+            0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL, 0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL};
+        memcpy(state, IV, sizeof(state));
+        bufferLength = 0;
+        totalLength = 0;
+    }
+
+    void update(const unsigned char *data, size_t length)
+    {
+        totalLength += length;
+        if (bufferLength > 0)
+        {
+            size_t take = min(length, sizeof(buffer) - bufferLength);
+            memcpy(buffer + bufferLength, data, take);
+            bufferLength += take;
+            data += take;
+            length -= take;
+            if (bufferLength < sizeof(buffer))
+            {
+                return;
+            }
+            compress(buffer);
+            bufferLength = 0;
+        }
+        while (length >= sizeof(buffer))
+        {
+            compress(data);
+            data += sizeof(buffer);
+            length -= sizeof(buffer);
+        }
+        memcpy(buffer, data, length);
+        bufferLength = length;
+    }
+
+    void finish(unsigned char *out)
+    {
+        uint64_t bitLength = totalLength * 8;
+        buffer[bufferLength++] = 0x80;
+        if (bufferLength > 112)
+        {
+            memset(buffer + bufferLength, 0, sizeof(buffer) - bufferLength);
+            compress(buffer);
+            bufferLength = 0;
+        }
+        memset(buffer + bufferLength, 0, 120 - bufferLength);
+        for (int i = 0; i < 8; i++)
+        {
+            buffer[120 + i] = static_cast<unsigned char>(bitLength >> (56 - 8 * i));
+        }
+        compress(buffer);
+
+        for (int i = 0; i < 8; i++)
+        {
+            for (int j = 0; j < 8; j++)
+            {
+                out[i * 8 + j] = static_cast<unsigned char>(state[i] >> (56 - 8 * j));
+            }
+        }
+        reset();
+    }
+
+    static void hash(const unsigned char *data, size_t length, unsigned char *out)
+    {
+        Sha512 ctx;
+        ctx.update(data, length);
+        ctx.finish(out);
+    }
+};
+
+// ============================================================================
+// SHA-256 HASH
+// ============================================================================
+// Single messages use the SHA extensions (SHA-NI) when the CPU has them.
+// hashMany() runs up to eight messages at once in the lanes of AVX2
+// registers, for batches of small payloads.
+class Sha256
+{
+private:
+    uint32_t state[8];
+    unsigned char buffer[64];
+    size_t bufferLength;
+    uint64_t totalLength;
+
+    static const uint32_t *roundConstants()
+    {
+        static const uint32_t K[64] = {
+            0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+            0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+            0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+            0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+            0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+            0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+            0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+            0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+        return K;
+    }
+
+    static const uint32_t *initialState()
+    {
+        static const uint32_t IV[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                       0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+        return IV;
+    }
+
+    static uint32_t rotr(uint32_t x, int n)
+    {
+        return (x >> n) | (x << (32 - n));
+    }
+
+    static uint32_t load32(const unsigned char *p)
+    {
+        return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | p[3];
+    }
+
+    static void store32(unsigned char *p, uint32_t value)
+    {
+        p[0] = static_cast<unsigned char>(value >> 24);
+        p[1] = static_cast<unsigned char>(value >> 16);
+        p[2] = static_cast<unsigned char>(value >> 8);
+        p[3] = static_cast<unsigned char>(value);
+    }
+
+    static void compressPortable(uint32_t *s, const unsigned char *data, size_t blocks)
+    {
+        const uint32_t *K = roundConstants();
+        for (; blocks > 0; blocks--, data += 64)
+        {
+            uint32_t w[64];
+            for (int i = 0; i < 16; i++)
+            {
+                w[i] = load32(data + i * 4);
+            }
+            for (int i = 16; i < 64; i++)
+            {
+                uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+                uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+                w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+            }
+
+            uint32_t a = s[0], b = s[1], c = s[2], d = s[3];
+            uint32_t e = s[4], f = s[5], g = s[6], h = s[7];
+            for (int i = 0; i < 64; i++)
+            {
+                uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + K[i] + w[i];
+                uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+                h = g;
+                g = f;
+                f = e;
+                e = d + t1;
+                d = c;
+                c = b;
+                b = a;
+                a = t1 + t2;
+            }
+
+            s[0] += a;
+            s[1] += b;
+            s[2] += c;
+            s[3] += d;
+            s[4] += e;
+            s[5] += f;
+            s[6] += g;
+            s[7] += h;
+        }
+    }
+
+#ifdef STEGO_HAVE_X86_SIMD
+    // State is kept as ABEF/CDGH register pairs; each group of four rounds
+    // also advances the message schedule for a later group
+    STEGO_TARGET("sha,sse4.1")
+    static void compressShaNi(uint32_t *s, const unsigned char *data, size_t blocks)
+    {
+        const __m128i byteSwap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+        const uint32_t *K = roundConstants();
+        __m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(s)), 0xB1);
+        __m128i state1 = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(s + 4)), 0x1B);
+        __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);
+        state1 = _mm_blend_epi16(state1, tmp, 0xF0);
+
+        for (; blocks > 0; blocks--, data += 64)
+        {
+            __m128i saved0 = state0;
+            __m128i saved1 = state1;
+            __m128i msg[4];
+            for (int g = 0; g < 16; g++)
+            {
+                __m128i &current = msg[g & 3];
+                if (g < 4)
+                {
+                    current = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data + g * 16)),
+                                               byteSwap);
+                }
+                __m128i rounds = _mm_add_epi32(current, _mm_loadu_si128(reinterpret_cast<const __m128i *>(K + g * 4)));
+                state1 = _mm_sha256rnds2_epu32(state1, state0, rounds);
+                if (g >= 3 && g <= 14)
+                {
+                    __m128i &next = msg[(g + 1) & 3];
+                    next = _mm_add_epi32(next, _mm_alignr_epi8(current, msg[(g + 3) & 3], 4));
+                    next = _mm_sha256msg2_epu32(next, current);
+                }
+                state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(rounds, 0x0E));
+                if (g >= 1 && g <= 12)
+                {
+                    msg[(g + 3) & 3] = _mm_sha256msg1_epu32(msg[(g + 3) & 3], current);
+                }
+            }
+            state0 = _mm_add_epi32(state0, saved0);
+            state1 = _mm_add_epi32(state1, saved1);
+        }
+
+        tmp = _mm_shuffle_epi32(state0, 0x1B);
+        state1 = _mm_shuffle_epi32(state1, 0xB1);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(s), _mm_blend_epi16(tmp, state1, 0xF0));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(s + 4), _mm_alignr_epi8(state1, tmp, 8));
+    }
+
+    STEGO_TARGET("avx2")
+    static __m256i rotr8(__m256i x, int n)
+    {
+        return _mm256_or_si256(_mm256_srli_epi32(x, n), _mm256_slli_epi32(x, 32 - n));
+    }
+
+    // One block for each of eight messages; lanes[word * 8 + lane]
+    STEGO_TARGET("avx2")
+    static void compress8(uint32_t *lanes, const unsigned char *const *blocks)
+    {
+        const uint32_t *K = roundConstants();
+        __m256i w[16];
+        for (int i = 0; i < 16; i++)
+        {
+            w[i] = _mm256_setr_epi32(load32(blocks[0] + i * 4), load32(blocks[1] + i * 4),
+                                     load32(blocks[2] + i * 4), load32(blocks[3] + i * 4),
+                                     load32(blocks[4] + i * 4), load32(blocks[5] + i * 4),
+                                     load32(blocks[6] + i * 4), load32(blocks[7] + i * 4));
+        }
+
+        __m256i v[8];
+        for (int i = 0; i < 8; i++)
+        {
+            v[i] = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(lanes + i * 8));
+        }
+        __m256i a = v[0], b = v[1], c = v[2], d = v[3], e = v[4], f = v[5], g = v[6], h = v[7];
+        for (int i = 0; i < 64; i++)
+        {
+            if (i >= 16)
+            {
+                __m256i w15 = w[(i - 15) & 15];
+                __m256i w2 = w[(i - 2) & 15];
+                __m256i s0 = _mm256_xor_si256(_mm256_xor_si256(rotr8(w15, 7), rotr8(w15, 18)),
+                                              _mm256_srli_epi32(w15, 3));
+                __m256i s1 = _mm256_xor_si256(_mm256_xor_si256(rotr8(w2, 17), rotr8(w2, 19)),
+                                              _mm256_srli_epi32(w2, 10));
+                w[i & 15] = _mm256_add_epi32(_mm256_add_epi32(w[i & 15], s0), _mm256_add_epi32(w[(i - 7) & 15], s1));
+            }
+            __m256i sum1 = _mm256_xor_si256(_mm256_xor_si256(rotr8(e, 6), rotr8(e, 11)), rotr8(e, 25));
+            __m256i choose = _mm256_xor_si256(_mm256_and_si256(e, f), _mm256_andnot_si256(e, g));
+            __m256i t1 = _mm256_add_epi32(_mm256_add_epi32(h, sum1), _mm256_add_epi32(choose, w[i & 15]));
+            t1 = _mm256_add_epi32(t1, _mm256_set1_epi32(static_cast<int>(K[i])));
+            __m256i sum0 = _mm256_xor_si256(_mm256_xor_si256(rotr8(a, 2), rotr8(a, 13)), rotr8(a, 22));
+            __m256i majority = _mm256_or_si256(_mm256_and_si256(a, b), _mm256_and_si256(c, _mm256_or_si256(a, b)));
+            __m256i t2 = _mm256_add_epi32(sum0, majority);
+            h = g;
+            g = f;
+            f = e;
+            e = _mm256_add_epi32(d, t1);
+            d = c;
+            c = b;
+            b = a;
+            a = _mm256_add_epi32(t1, t2);
+        }
+
+        __m256i out[8] = {a, b, c, d, e, f, g, h};
+        for (int i = 0; i < 8; i++)
+        {
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(lanes + i * 8), _mm256_add_epi32(v[i], out[i]));
+        }
+    }
+#endif
+
+    static bool cpuHasShaNi()
+    {
+#ifdef STEGO_HAVE_X86_SIMD
+        __builtin_cpu_init();
+        unsigned int eax, ebx, ecx, edx;
+        return __builtin_cpu_supports("sse4.1") && __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) &&
+               (ebx & (1u << 29)) != 0;
+#else
+        return false;
+#endif
+    }
+
+    static bool cpuHasAvx2()
+    {
+#ifdef STEGO_HAVE_X86_SIMD
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+#else
+        return false;
+#endif
+    }
+
+    static bool &shaNiEnabled()
+    {
+        static bool enabled = cpuHasShaNi();
+        return enabled;
+    }
+
+    static bool &multiBufferEnabled()
+    {
+        static bool enabled = cpuHasAvx2();
+        return enabled;
+    }
+
+    static void compress(uint32_t *s, const unsigned char *data, size_t blocks)
+    {
+#ifdef STEGO_HAVE_X86_SIMD
+        if (shaNiEnabled())
+        {
+            compressShaNi(s, data, blocks);
+            return;
+        }
+#endif
+        compressPortable(s, data, blocks);
+    }
+
+    // Final one or two blocks: the message tail, 0x80, zeros, bit length
+    static size_t padTail(const unsigned char *tail, size_t tailLength, uint64_t totalLength, unsigned char *out)
+    {
+        size_t blocks = tailLength + 9 <= 64 ? 1 : 2;
+        memset(out, 0, blocks * 64);
+        if (tailLength > 0)
+        {
+            memcpy(out, tail, tailLength);
+        }
+        out[tailLength] = 0x80;
+        uint64_t bitLength = totalLength * 8;
+        store32(out + blocks * 64 - 8, static_cast<uint32_t>(bitLength >> 32));
+        store32(out + blocks * 64 - 4, static_cast<uint32_t>(bitLength));
+        return blocks;
+    }
+
+public:
+    static const size_t DIGEST_SIZE = 32;
+
+    Sha256() { reset(); }
+
+    static bool hasShaNi()
+    {
+        return cpuHasShaNi();
+    }
+
+    static bool hasMultiBuffer()
+    {
+        return cpuHasAvx2();
+    }
+
+    // Turns accelerated paths off (never on where the CPU lacks them); the
+    // benchmark compares the paths this way
+    static void setAcceleration(bool shaNi, bool multiBuffer)
+    {
+        shaNiEnabled() = shaNi && cpuHasShaNi();
+        multiBufferEnabled() = multiBuffer && cpuHasAvx2();
+    }
+
+    void reset()
+    {
+        memcpy(state, initialState(), sizeof(state));
+        bufferLength = 0;
+        totalLength = 0;
+    }
+
+    void update(const unsigned char *data, size_t length)
+    {
+        if (length == 0)
+        {
+            return;
+        }
+        totalLength += length;
+        if (bufferLength > 0)
+        {
+            size_t take = min(length, sizeof(buffer) - bufferLength);
+            memcpy(buffer + bufferLength, data, take);
+            bufferLength += take;
+            data += take;
+            length -= take;
+            if (bufferLength < sizeof(buffer))
+            {
+                return;
+            }
+            compress(state, buffer, 1);
+            bufferLength = 0;
+        }
+        if (length >= sizeof(buffer))
+        {
+            compress(state, data, length / sizeof(buffer));
+            data += length - length % sizeof(buffer);
+            length %= sizeof(buffer);
+        }
+        memcpy(buffer, data, length);
+        bufferLength = length;
+    }
+
+    void finish(unsigned char *out)
+    {
+        unsigned char tail[128];
+        compress(state, tail, padTail(buffer, bufferLength, totalLength, tail));
+        for (int i = 0; i < 8; i++)
+        {
+            store32(out + i * 4, state[i]);
+        }
+        reset();
+    }
+
+    static void hash(const unsigned char *data, size_t length, unsigned char *out)
+    {
+        Sha256 ctx;
+        ctx.update(data, length);
+        ctx.finish(out);
+    }
+
+    // Digests of many messages into out[i * DIGEST_SIZE]. With AVX2 the
+    // messages share eight lanes: a lane whose message ends takes the next.
+    // SHA-NI keeps up with the lanes from a few hundred bytes on, so where
+    // it exists only the short messages go into lanes.
+    static void hashMany(const vector<const unsigned char *> &data, const vector<size_t> &lengths, unsigned char *out)
+    {
+        vector<size_t> queued;
+        for (size_t i = 0; i < data.size(); i++)
+        {
+            if (multiBufferEnabled() && (!shaNiEnabled() || lengths[i] <= Config::SHA256_LANE_MAX_MESSAGE))
+            {
+                queued.push_back(i);
+            }
+            else
+            {
+                hash(data[i], lengths[i], out + i * DIGEST_SIZE);
+            }
+        }
+        size_t count = queued.size();
+#ifdef STEGO_HAVE_X86_SIMD
+        if (count > 1)
+        {
+            struct Lane
+            {
+                size_t message;
+                size_t block;
+                size_t fullBlocks;
+                size_t totalBlocks;
+                unsigned char tail[128];
+            };
+            static const unsigned char idle[64] = {0};
+            Lane lane[8];
+            uint32_t lanes[64];
+            const unsigned char *blocks[8];
+            size_t next = 0;
+            size_t active = 0;
+
+            for (int l = 0; l < 8; l++)
+            {
+                lane[l].message = SIZE_MAX;
+            }
+            while (true)
+            {
+                for (int l = 0; l < 8; l++)
+                {
+                    if (lane[l].message == SIZE_MAX && next < count)
+                    {
+                        Lane &fresh = lane[l];
+                        fresh.message = queued[next++];
+                        fresh.block = 0;
+                        fresh.fullBlocks = lengths[fresh.message] / 64;
+                        size_t tailLength = lengths[fresh.message] % 64;
+                        fresh.totalBlocks = fresh.fullBlocks +
+                                            padTail(data[fresh.message] + fresh.fullBlocks * 64, tailLength,
+                                                    lengths[fresh.message], fresh.tail);
+                        for (int i = 0; i < 8; i++)
+                        {
+                            lanes[i * 8 + l] = initialState()[i];
+                        }
+                        active++;
+                    }
+                    const Lane &current = lane[l];
+                    if (current.message == SIZE_MAX)
+                    {
+                        blocks[l] = idle;
+                    }
+                    else if (current.block < current.fullBlocks)
+                    {
+                        blocks[l] = data[current.message] + current.block * 64;
+                    }
+                    else
+                    {
+                        blocks[l] = current.tail + (current.block - current.fullBlocks) * 64;
+                    }
+                }
+                if (active == 0)
+                {
+                    return;
+                }
+
+                compress8(lanes, blocks);
+                for (int l = 0; l < 8; l++)
+                {
+                    Lane &current = lane[l];
+                    if (current.message != SIZE_MAX && ++current.block == current.totalBlocks)
+                    {
+                        for (int i = 0; i < 8; i++)
+                        {
+                            store32(out + current.message * DIGEST_SIZE + i * 4, lanes[i * 8 + l]);
+                        }
+                        current.message = SIZE_MAX;
+                        active--;
+                    }
+                }
+            }
+        }
+#endif
+        for (size_t i = 0; i < count; i++)
+        {
+            hash(data[queued[i]], lengths[queued[i]], out + queued[i] * DIGEST_SIZE);
+        }
+    }
+};
+
+// ============================================================================
+// ED25519 SIGNATURES
+// ============================================================================
+// Field arithmetic uses 16 limbs of 16 bits (TweetNaCl layout). Signing runs in
+// constant time; verification works on public data only and uses a windowed
+// multi-scalar multiplication so that batches share a single doubling chain.
+// Single and batch verification both check the cofactored equation
+// [8](sB - R - hA) = 0, so a signature is accepted or rejected the same way
+// whichever batch it lands in.
+namespace Ed25519
+{
+    const size_t PUBLIC_KEY_SIZE = 32;
+    const size_t SECRET_KEY_SIZE = 64;
+    const size_t SIGNATURE_SIZE = 64;
+
+    typedef int64_t gf[16];
+
+    struct Point
+    {
+        gf c[4];
+    };
+
+    struct BatchEntry
+    {
+        const unsigned char *publicKey;
+        const unsigned char *signature;
+        const unsigned char *message;
+        size_t messageLength;
+    };
+
+    const gf GF0 = {0};
+    const gf GF1 = {1};
+    const gf D = {0x78a3, 0x1359, 0x4dca, 0x75eb, 0xd8ab, 0x4141, 0x0a4d, 0x0070,
+                  0xe898, 0x7779, 0x4079, 0x8cc7, 0xfe73, 0x2b6f, 0x6cee, 0x5203};
+    const gf D2 = {0xf159, 0x26b2, 0x9b94, 0xebd6, 0xb156, 0x8283, 0x149a, 0x00e0,
+                   0xd130, 0xeef3, 0x80f2, 0x198e, 0xfce7, 0x56df, 0xd9dc, 0x2406};
+    const gf BX = {0xd51a, 0x8f25, 0x2d60, 0xc956, 0xa7b2, 0x9525, 0xc760, 0x692c,
+                   0xdc5c, 0xfdd6, 0xe231, 0xc0a4, 0x53fe, 0xcd6e, 0x36d3, 0x2169};
+    const gf BY = {0x6658, 0x6666, 0x6666, 0x6666, 0x6666, 0x6666, 0x6666, 0x6666,
+                   0x6666, 0x6666, 0x6666, 0x6666, 0x6666, 0x6666, 0x6666, 0x6666};
+    const gf SQRTM1 = {0xa0b0, 0x4a0e, 0x1b27, 0xc4ee, 0xe478, 0xad2f, 0x1806, 0x2f43,
+                       0xd7a7, 0x3dfb, 0x0099, 0x2b4d, 0xdf0b, 0x4fc1, 0x2480, 0x2b83};
+    const int64_t L[32] = {0xed, 0xd3, 0xf5, 0x5c, 0x1a, 0x63, 0x12, 0x58,
+                           0xd6, 0x9c, 0xf7, 0xa2, 0xde, 0xf9, 0xde, 0x14,
+                           0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x10};
+
+    inline void fset(gf r, const gf a)
+    {
+        for (int i = 0; i < 16; i++)
+            r[i] = a[i];
+    }
+
+    inline void carry(gf o)
+    {
+        for (int i = 0; i < 16; i++)
+        {
+            o[i] += (int64_t(1) << 16);
+            int64_t c = o[i] >> 16;
+            o[(i + 1) * (i < 15)] += c - 1 + 37 * (c - 1) * (i == 15);
+            o[i] -= c * 65536;
+        }
+    }
+
+    inline void select(gf p, gf q, int b)
+    {
+        int64_t c = ~(int64_t(b) - 1);
+        for (int i = 0; i < 16; i++)
+        {
+            int64_t t = c & (p[i] ^ q[i]);
+            p[i] ^= t;
+            q[i] ^= t;
+        }
+    }
+
+    void pack25519(unsigned char *o, const gf n)
+    {
+        gf m, t;
+        fset(t, n);
+        carry(t);
+        carry(t);
+        carry(t);
+        for (int j = 0; j < 2; j++)
+        {
+            m[0] = t[0] - 0xffed;
+            for (int i = 1; i < 15; i++)
+            {
+                m[i] = t[i] - 0xffff - ((m[i - 1] >> 16) & 1);
+                m[i - 1] &= 0xffff;
+            }
+            m[15] = t[15] - 0x7fff - ((m[14] >> 16) & 1);
+            int b = static_cast<int>((m[15] >> 16) & 1);
+            m[14] &= 0xffff;
+            select(t, m, 1 - b);
+        }
+        for (int i = 0; i < 16; i++)
+        {
+            o[2 * i] = static_cast<unsigned char>(t[i] & 0xff);
+            o[2 * i + 1] = static_cast<unsigned char>(t[i] >> 8);
+        }
+    }
+
+    inline void unpack25519(gf o, const unsigned char *n)
+    {
+        for (int i = 0; i < 16; i++)
+            o[i] = n[2 * i] + (int64_t(n[2 * i + 1]) << 8);
+        o[15] &= 0x7fff;
+    }
+
+    inline bool equal25519(const gf a, const gf b)
+    {
+        unsigned char c[32], d[32];
+        pack25519(c, a);
+        pack25519(d, b);
+        return memcmp(c, d, 32) == 0;
+    }
+
+    inline int parity25519(const gf a)
+    {
+        unsigned char d[32];
+        pack25519(d, a);
+        return d[0] & 1;
+    }
+
+    inline void fadd(gf o, const gf a, const gf b)
+    {
+        for (int i = 0; i < 16; i++)
+            o[i] = a[i] + b[i];
+    }
+
+    inline void fsub(gf o, const gf a, const gf b)
+    {
+        for (int i = 0; i < 16; i++)
+            o[i] = a[i] - b[i];
+    }
+
+    inline void fmul(gf o, const gf a, const gf b)
+    {
+        int64_t t[31];
+        for (int i = 0; i < 31; i++)
+            t[i] = 0;
+        for (int i = 0; i < 16; i++)
+            for (int j = 0; j < 16; j++)
+                t[i + j] += a[i] * b[j];
+        for (int i = 0; i < 15; i++)
+            t[i] += 38 * t[i + 16];
+        for (int i = 0; i < 16; i++)
+            o[i] = t[i];
+        carry(o);
+        carry(o);
+    }
+
+    inline void fsquare(gf o, const gf a)
+    {
+        fmul(o, a, a);
+    }
+
+    void invert25519(gf o, const gf in)
+    {
+        gf c;
+        fset(c, in);
+        for (int a = 253; a >= 0; a--)
+        {
+            fsquare(c, c);
+            if (a != 2 && a != 4)
+                fmul(c, c, in);
+        }
+        fset(o, c);
+    }
+
+    void pow2523(gf o, const gf in)
+    {
+        gf c;
+        fset(c, in);
+        for (int a = 250; a >= 0; a--)
+        {
+            fsquare(c, c);
+            if (a != 1)
+                fmul(c, c, in);
+        }
+        fset(o, c);
+    }
+
+    void setIdentity(Point &p)
+    {
+        fset(p.c[0], GF0);
+        fset(p.c[1], GF1);
+        fset(p.c[2], GF1);
+        fset(p.c[3], GF0);
+    }
+
+    // Unified extended-coordinate addition; safe when p and q alias.
+    void pointAdd(Point &p, const Point &q)
+    {
+        gf a, b, c, d, t, e, f, g, h;
+        fsub(a, p.c[1], p.c[0]);
+        fsub(t, q.c[1], q.c[0]);
+        fmul(a, a, t);
+        fadd(b, p.c[0], p.c[1]);
+        fadd(t, q.c[0], q.c[1]);
+        fmul(b, b, t);
+        fmul(c, p.c[3], q.c[3]);
+        fmul(c, c, D2);
+        fmul(d, p.c[2], q.c[2]);
+        fadd(d, d, d);
+        fsub(e, b, a);
+        fsub(f, d, c);
+        fadd(g, d, c);
+        fadd(h, b, a);
+        fmul(p.c[0], e, f);
+        fmul(p.c[1], h, g);
+        fmul(p.c[2], g, f);
+        fmul(p.c[3], e, h);
+    }
+
+    void pointSwap(Point &p, Point &q, int b)
+    {
+        for (int i = 0; i < 4; i++)
+            select(p.c[i], q.c[i], b);
+    }
+
+    void pointPack(unsigned char *r, const Point &p)
+    {
+        gf tx, ty, zi;
+        invert25519(zi, p.c[2]);
+        fmul(tx, p.c[0], zi);
+        fmul(ty, p.c[1], zi);
+        pack25519(r, ty);
+        r[31] ^= static_cast<unsigned char>(parity25519(tx) << 7);
+    }
+
+    // Decodes a compressed point and negates it, as verification needs -A and -R
+    bool pointUnpackNegative(Point &r, const unsigned char *p)
+    {
+        gf t, chk, num, den, den2, den4, den6;
+        fset(r.c[2], GF1);
+        unpack25519(r.c[1], p);
+        fsquare(num, r.c[1]);
+        fmul(den, num, D);
+        fsub(num, num, r.c[2]);
+        fadd(den, r.c[2], den);
+
+        fsquare(den2, den);
+        fsquare(den4, den2);
+        fmul(den6, den4, den2);
+        fmul(t, den6, num);
+        fmul(t, t, den);
+
+        pow2523(t, t);
+        fmul(t, t, num);
+        fmul(t, t, den);
+        fmul(t, t, den);
+        fmul(r.c[0], t, den);
+
+        fsquare(chk, r.c[0]);
+        fmul(chk, chk, den);
+        if (!equal25519(chk, num))
+            fmul(r.c[0], r.c[0], SQRTM1);
+
+        fsquare(chk, r.c[0]);
+        fmul(chk, chk, den);
+        if (!equal25519(chk, num))
+            return false;
+
+        if (parity25519(r.c[0]) == (p[31] >> 7))
+            fsub(r.c[0], GF0, r.c[0]);
+
+        fmul(r.c[3], r.c[0], r.c[1]);
+        return true;
+    }
+
+    // Constant-time ladder, used for secret scalars
+    void scalarMult(Point &p, Point q, const unsigned char *s)
+    {
+        setIdentity(p);
+        for (int i = 255; i >= 0; --i)
+        {
+            int b = (s[i / 8] >> (i & 7)) & 1;
+            pointSwap(p, q, b);
+            pointAdd(q, p);
+            pointAdd(p, p);
+            pointSwap(p, q, b);
+        }
+    }
+
+    void basePoint(Point &q)
+    {
+        fset(q.c[0], BX);
+        fset(q.c[1], BY);
+        fset(q.c[2], GF1);
+        fmul(q.c[3], BX, BY);
+    }
+
+    void scalarBase(Point &p, const unsigned char *s)
+    {
+        Point q;
+        basePoint(q);
+        scalarMult(p, q, s);
+    }
+
+    void modL(unsigned char *r, int64_t x[64])
+    {
+        int64_t c;
+        for (int i = 63; i >= 32; --i)
+        {
+            c = 0;
+            int j;
+            for (j = i - 32; j < i - 12; ++j)
+            {
+                x[j] += c - 16 * x[i] * L[j - (i - 32)];
+                c = (x[j] + 128) >> 8;
+                x[j] -= c * 256;
+            }
+            x[j] += c;
+            x[i] = 0;
+        }
+        c = 0;
+        for (int j = 0; j < 32; j++)
+        {
+            x[j] += c - (x[31] >> 4) * L[j];
+            c = x[j] >> 8;
+            x[j] &= 255;
+        }
+        for (int j = 0; j < 32; j++)
+            x[j] -= c * L[j];
+        for (int i = 0; i < 32; i++)
+        {
+            x[i + 1] += x[i] >> 8;
+            r[i] = static_cast<unsigned char>(x[i] & 255);
+        }
+    }
+
+    void reduce(unsigned char *r)
+    {
+        int64_t x[64];
+        for (int i = 0; i < 64; i++)
+            x[i] = r[i];
+        memset(r, 0, 64);
+        modL(r, x);
+    }
+
+    void scalarMulAdd(unsigned char *r, const unsigned char *a, const unsigned char *b, const unsigned char *c)
+    {
+        int64_t x[64] = {0};
+        for (int i = 0; i < 32; i++)
+            x[i] = c[i];
+        for (int i = 0; i < 32; i++)
+            for (int j = 0; j < 32; j++)
+                x[i + j] += int64_t(a[i]) * b[j];
+        modL(r, x);
+    }
+
+    bool scalarIsCanonical(const unsigned char *s)
+    {
+        for (int i = 31; i >= 0; i--)
+        {
+            if (s[i] != L[i])
+                return s[i] < L[i];
+        }
+        return false;
+    }
+
+    void derivePublicKey(unsigned char *secretKey)
+    {
+        unsigned char d[64];
+        Sha512::hash(secretKey, 32, d);
+        d[0] &= 248;
+        d[31] &= 127;
+        d[31] |= 64;
+
+        Point p;
+        scalarBase(p, d);
+        pointPack(secretKey + 32, p);
+    }
+
+    // secretKey is seed || publicKey (64 bytes)
+    void sign(unsigned char *signature, const unsigned char *message, size_t length,
+              const unsigned char *secretKey)
+    {
+        unsigned char d[64], r[64], h[64];
+        Sha512::hash(secretKey, 32, d);
+        d[0] &= 248;
+        d[31] &= 127;
+        d[31] |= 64;
+
+        Sha512 ctx;
+        ctx.update(d + 32, 32);
+        ctx.update(message, length);
+        ctx.finish(r);
+        reduce(r);
+
+        Point p;
+        scalarBase(p, r);
+        pointPack(signature, p);
+
+        ctx.update(signature, 32);
+        ctx.update(secretKey + 32, 32);
+        ctx.update(message, length);
+        ctx.finish(h);
+        reduce(h);
+
+        scalarMulAdd(signature + 32, h, d, r);
+    }
+
+    void challenge(unsigned char *h, const unsigned char *signature, const unsigned char *publicKey,
+                   const unsigned char *message, size_t length)
+    {
+        Sha512 ctx;
+        ctx.update(signature, 32);
+        ctx.update(publicKey, 32);
+        ctx.update(message, length);
+        ctx.finish(h);
+        reduce(h);
+    }
+
+    // Straus multi-scalar multiplication with 4-bit windows: all points share
+    // one chain of 252 doublings, each point costs 15 additions of table setup
+    // plus at most one addition per non-zero window.
+    void multiScalarMult(Point &out, const vector<Point> &points, const vector<unsigned char> &scalars)
+    {
+        size_t count = points.size();
+        vector<Point> tables(count * 16);
+        for (size_t j = 0; j < count; j++)
+        {
+            Point *table = &tables[j * 16];
+            setIdentity(table[0]);
+            table[1] = points[j];
+            for (int k = 2; k < 16; k++)
+            {
+                table[k] = table[k - 1];
+                pointAdd(table[k], points[j]);
+            }
+        }
+
+        setIdentity(out);
+        bool started = false;
+        for (int window = 63; window >= 0; window--)
+        {
+            if (started)
+            {
+                for (int k = 0; k < 4; k++)
+                    pointAdd(out, out);
+            }
+            for (size_t j = 0; j < count; j++)
+            {
+                int digit = (scalars[j * 32 + window / 2] >> (4 * (window & 1))) & 15;
+                if (digit != 0)
+                {
+                    pointAdd(out, tables[j * 16 + digit]);
+                    started = true;
+                }
+            }
+        }
+    }
+
+    bool isIdentityTimesCofactor(Point p)
+    {
+        for (int k = 0; k < 3; k++)
+            pointAdd(p, p);
+
+        unsigned char packed[32];
+        unsigned char identity[32] = {1};
+        pointPack(packed, p);
+        return memcmp(packed, identity, 32) == 0;
+    }
+
+    // Variable-time: one multi-scalar multiplication over B, -A and -R
+    bool verify(const unsigned char *signature, const unsigned char *message, size_t length,
+                const unsigned char *publicKey)
+    {
+        if (!scalarIsCanonical(signature + 32))
+            return false;
+
+        vector<Point> points(3);
+        basePoint(points[0]);
+        if (!pointUnpackNegative(points[1], publicKey) || !pointUnpackNegative(points[2], signature))
+            return false;
+
+        unsigned char h[64];
+        challenge(h, signature, publicKey, message, length);
+
+        vector<unsigned char> scalars(3 * 32, 0);
+        memcpy(&scalars[0], signature + 32, 32);
+        memcpy(&scalars[32], h, 32);
+        scalars[64] = 1;
+
+        Point sum;
+        multiScalarMult(sum, points, scalars);
+        return isIdentityTimesCofactor(sum);
+    }
+
+    // One signature of a batch, decoded once: -R, the slot of -A in the key
+    // list, the challenge h and the random 128-bit weight z
+    struct BatchTerm
+    {
+        size_t entry;
+        Point negR;
+        size_t key;
+        unsigned char h[32];
+        unsigned char z[32];
+    };
+
+    // Entries with a non-canonical s or an undecodable point get no term
+    void prepareBatch(const vector<BatchEntry> &entries, vector<BatchTerm> &terms, vector<Point> &keys)
+    {
+        random_device rng;
+        map<string, size_t> keyIndex;
+        for (size_t i = 0; i < entries.size(); i++)
+        {
+            const BatchEntry &e = entries[i];
+            BatchTerm term;
+            term.entry = i;
+            if (!scalarIsCanonical(e.signature + 32) || !pointUnpackNegative(term.negR, e.signature))
+                continue;
+
+            string key(reinterpret_cast<const char *>(e.publicKey), PUBLIC_KEY_SIZE);
+            map<string, size_t>::iterator it = keyIndex.find(key);
+            if (it == keyIndex.end())
+            {
+                Point negA;
+                if (!pointUnpackNegative(negA, e.publicKey))
+                    continue;
+                it = keyIndex.insert(make_pair(key, keys.size())).first;
+                keys.push_back(negA);
+            }
+            term.key = it->second;
+
+            unsigned char h[64];
+            challenge(h, e.signature, e.publicKey, e.message, e.messageLength);
+            memcpy(term.h, h, 32);
+            memset(term.z, 0, sizeof(term.z));
+            for (int k = 0; k < 16; k += 4)
+            {
+                uint32_t word = rng();
+                memcpy(term.z + k, &word, 4);
+            }
+            term.z[0] |= 1;
+            terms.push_back(term);
+        }
+    }
+
+    // (sum z_i s_i) B - sum z_i R_i - sum (z_i h_i) A_i over terms[first, first + count).
+    // Terms for the same public key are merged, so a batch from one signer
+    // costs one multi-scalar multiplication over n + 2 points.
+    void batchSum(Point &sum, const vector<BatchEntry> &entries, const vector<BatchTerm> &terms,
+                  const vector<Point> &keys, size_t first, size_t count)
+    {
+        vector<Point> points(1);
+        vector<unsigned char> scalars(32, 0);
+        map<size_t, size_t> keySlot;
+        basePoint(points[0]);
+
+        for (size_t i = first; i < first + count; i++)
+        {
+            const BatchTerm &term = terms[i];
+            scalarMulAdd(&scalars[0], term.z, entries[term.entry].signature + 32, &scalars[0]);
+            points.push_back(term.negR);
+            scalars.insert(scalars.end(), term.z, term.z + 32);
+
+            map<size_t, size_t>::iterator it = keySlot.find(term.key);
+            if (it == keySlot.end())
+            {
+                it = keySlot.insert(make_pair(term.key, points.size())).first;
+                points.push_back(keys[term.key]);
+                scalars.insert(scalars.end(), 32, 0);
+            }
+            unsigned char *aScalar = &scalars[it->second * 32];
+            scalarMulAdd(aScalar, term.z, term.h, aScalar);
+        }
+        multiScalarMult(sum, points, scalars);
+    }
+
+    // Marks the terms of a range valid when their combined sum passes. A
+    // failing range is split in half; the weights stay fixed, so the right
+    // half's sum is the range's sum minus the left half's and each level costs
+    // one multi-scalar multiplication over half the range.
+    void bisectBatch(const vector<BatchEntry> &entries, const vector<BatchTerm> &terms, const vector<Point> &keys,
+                     size_t first, size_t count, const Point &sum, vector<bool> &valid)
+    {
+        if (isIdentityTimesCofactor(sum))
+        {
+            for (size_t i = first; i < first + count; i++)
+                valid[terms[i].entry] = true;
+            return;
+        }
+        if (count == 1)
+            return;
+
+        size_t half = count / 2;
+        Point left, right;
+        batchSum(left, entries, terms, keys, first, half);
+        right = left;
+        fsub(right.c[0], GF0, right.c[0]);
+        fsub(right.c[3], GF0, right.c[3]);
+        pointAdd(right, sum);
+        bisectBatch(entries, terms, keys, first, half, left, valid);
+        bisectBatch(entries, terms, keys, first + half, count - half, right, valid);
+    }
+
+    // Checks [8]( (sum z_i s_i) B - sum z_i R_i - sum (z_i h_i) A_i ) == 0
+    bool verifyBatch(const vector<BatchEntry> &entries)
+    {
+        if (entries.empty())
+            return true;
+        if (entries.size() == 1)
+        {
+            const BatchEntry &e = entries[0];
+            return verify(e.signature, e.message, e.messageLength, e.publicKey);
+        }
+
+        vector<BatchTerm> terms;
+        vector<Point> keys;
+        prepareBatch(entries, terms, keys);
+        if (terms.size() != entries.size())
+            return false;
+
+        Point sum;
+        batchSum(sum, entries, terms, keys, 0, terms.size());
+        return isIdentityTimesCofactor(sum);
+    }
+
+    // Per-entry results for a batch; true when every signature is valid. Bad
+    // signatures are found by bisection, so k of them cost O(k log n)
+    // half-size checks rather than one single verification per entry.
+    bool verifyEach(const vector<BatchEntry> &entries, vector<bool> &valid)
+    {
+        valid.assign(entries.size(), false);
+        if (entries.size() == 1)
+        {
+            const BatchEntry &e = entries[0];
+            valid[0] = verify(e.signature, e.message, e.messageLength, e.publicKey);
+        }
+        else if (!entries.empty())
+        {
+            vector<BatchTerm> terms;
+            vector<Point> keys;
+            prepareBatch(entries, terms, keys);
+            if (!terms.empty())
+            {
+                Point sum;
+                batchSum(sum, entries, terms, keys, 0, terms.size());
+                bisectBatch(entries, terms, keys, 0, terms.size(), sum, valid);
+            }
+        }
+        return find(valid.begin(), valid.end(), false) == valid.end();
+    }
+
+    void generateSecretKey(unsigned char *secretKey)
+    {
+        random_device rng;
+        for (size_t i = 0; i < 32; i += 4)
+        {
+            uint32_t word = rng();
+            memcpy(secretKey + i, &word, 4);
+        }
+        derivePublicKey(secretKey);
+    }
+}
+
+// ============================================================================
+// HEADER EXTENSIONS
+// ============================================================================
+// Optional records stored right after the hidden payload:
+//   [ExtensionBlockHeader][type:u16][length:u16][data]...
+// Readers that only know StegoHeader ignore the trailing block.
+struct ExtensionBlockHeader
+{
+    uint32_t magic;
+    uint16_t recordCount;
+    uint16_t reserved;
+    uint32_t totalLength;
+    uint32_t checksum;
+};
+
+struct ExtensionRecord
+{
+    uint16_t type;
+    vector<unsigned char> data;
+
+    ExtensionRecord() : type(0) {}
+    ExtensionRecord(uint16_t t, const vector<unsigned char> &d) : type(t), data(d) {}
+};
+
+class HeaderExtensions
+{
+private:
+    static uint32_t checksum(const unsigned char *data, size_t length)
+    {
+        uint32_t sum = Config::EXTENSION_MAGIC;
+        for (size_t i = 0; i < length; i++)
+        {
+            sum = sum * 31 + data[i];
+        }
+        return sum;
+    }
+
+public:
+    static vector<unsigned char> serialize(const vector<ExtensionRecord> &records)
+    {
+        vector<unsigned char> body;
+        for (size_t i = 0; i < records.size(); i++)
+        {
+            uint16_t type = records[i].type;
+            uint16_t length = static_cast<uint16_t>(records[i].data.size());
+            size_t pos = body.size();
+            body.resize(pos + 4 + length);
+            memcpy(&body[pos], &type, 2);
+            memcpy(&body[pos + 2], &length, 2);
+            if (length > 0)
+            {
+                memcpy(&body[pos + 4], records[i].data.data(), length);
+            }
+        }
+
+        ExtensionBlockHeader block;
+        block.magic = Config::EXTENSION_MAGIC;
+        block.recordCount = static_cast<uint16_t>(records.size());
+        block.reserved = 0;
+        block.totalLength = static_cast<uint32_t>(body.size());
+        block.checksum = checksum(body.data(), body.size());
+
+        vector<unsigned char> out(sizeof(block) + body.size());
+        memcpy(out.data(), &block, sizeof(block));
+        if (!body.empty())
+        {
+            memcpy(out.data() + sizeof(block), body.data(), body.size());
+        }
+        return out;
+    }
+
+    // A one-record block written into out, which must hold
+    // sizeof(ExtensionBlockHeader) + 4 + length bytes; returns the size
+    static size_t serializeRecord(uint16_t type, const unsigned char *data, uint16_t length, unsigned char *out)
+    {
+        unsigned char *body = out + sizeof(ExtensionBlockHeader);
+        memcpy(body, &type, 2);
+        memcpy(body + 2, &length, 2);
+        memcpy(body + 4, data, length);
+
+        ExtensionBlockHeader block;
+        block.magic = Config::EXTENSION_MAGIC;
+        block.recordCount = 1;
+        block.reserved = 0;
+        block.totalLength = 4u + length;
+        block.checksum = checksum(body, block.totalLength);
+        memcpy(out, &block, sizeof(block));
+        return sizeof(block) + block.totalLength;
+    }
+
+    // Returns no records when the block is absent; throws when it is damaged
+    static vector<ExtensionRecord> parse(const unsigned char *data, size_t available)
+    {
+        vector<ExtensionRecord> records;
+        ExtensionBlockHeader block;
+        if (available < sizeof(block))
+        {
+            return records;
+        }
+        memcpy(&block, data, sizeof(block));
+        if (block.magic != Config::EXTENSION_MAGIC)
+        {
+            return records;
+        }
+
+        const unsigned char *body = data + sizeof(block);
+        if (block.totalLength > available - sizeof(block) ||
+            block.checksum != checksum(body, block.totalLength))
+        {
+            throw InvalidFormatException("Corrupted header extension block");
+        }
+
+        size_t pos = 0;
+        for (uint16_t i = 0; i < block.recordCount; i++)
+        {
+            uint16_t type, length;
+            if (pos + 4 > block.totalLength)
+            {
+                throw InvalidFormatException("Truncated header extension record");
+            }
+            memcpy(&type, body + pos, 2);
+            memcpy(&length, body + pos + 2, 2);
+            pos += 4;
+            if (pos + length > block.totalLength)
+            {
+                throw InvalidFormatException("Truncated header extension record");
+            }
+            records.push_back(ExtensionRecord(type, vector<unsigned char>(body + pos, body + pos + length)));
+            pos += length;
+        }
+        return records;
+    }
+
+    static const ExtensionRecord *find(const vector<ExtensionRecord> &records, uint16_t type)
+    {
+        for (size_t i = 0; i < records.size(); i++)
+        {
+            if (records[i].type == type)
+            {
+                return &records[i];
+            }
+        }
+        return NULL;
+    }
+};
+
+// ============================================================================
+// FILE VALIDATOR CLASS
+// ============================================================================
+class FileValidator
+{
+public:
+    static void validateFileAccess(const string &filename, const string &fileType)
+    {
+        if (filename.empty())
+        {
+            throw FileAccessException(fileType + " path cannot be empty");
+        }
+
+        if (!Utils::fileExists(filename))
+        {
+            throw FileAccessException(fileType + " not found or not accessible: " + filename);
+        }
+    }
+
+    static size_t validateAndCalculateMaxSize(size_t hiddenSize, size_t hostSize)
+    {
+        // Check minimum host size
+        if (hostSize < Config::MIN_HOST_SIZE)
+        {
+            throw FileSizeException(
+                "Host file too small. Minimum size: " +
+                Utils::formatBytes(Config::MIN_HOST_SIZE));
+        }
+
+        // Calculate maximum allowed hidden size
+        size_t maxHiddenSize = static_cast<size_t>(
+            hostSize * Config::MAX_HIDDEN_SIZE_RATIO);
+
+        // Account for header size
+        size_t headerSize = sizeof(StegoHeader);
+        if (maxHiddenSize < headerSize)
+        {
+            throw FileSizeException("Host file too small to hide any data");
+        }
+
+        maxHiddenSize -= headerSize;
+
+        checkFits(hiddenSize, maxHiddenSize);
+        return maxHiddenSize;
+    }
+
+    // Pixel engines: capacity is the number of stream bytes the cover can carry
+    static size_t validateStreamCapacity(size_t hiddenSize, size_t streamCapacity, size_t reservedBytes)
+    {
+        size_t overhead = sizeof(StegoHeader) + reservedBytes;
+        if (streamCapacity <= overhead)
+        {
+            throw FileSizeException("Host file too small to hide any data");
+        }
+
+        size_t maxHiddenSize = streamCapacity - overhead;
+        checkFits(hiddenSize, maxHiddenSize);
+        return maxHiddenSize;
+    }
+
+private:
+    static void checkFits(size_t hiddenSize, size_t maxHiddenSize)
+    {
+        if (hiddenSize > maxHiddenSize)
+        {
+            throw FileSizeException(
+                "The file to hide exceeds the allowable size.\n" +
+                string("  File size: ") + Utils::formatBytes(hiddenSize) + "\n" +
+                string("  Maximum allowed: ") + Utils::formatBytes(maxHiddenSize) + "\n" +
+                string("  Please choose a smaller file or a larger host file."));
+        }
+    }
+};
+
+// ============================================================================
+// FILE IO MANAGER CLASS
+// ============================================================================
+class FileIOManager
+{
+public:
+    static vector<unsigned char> readFile(const string &filename)
+    {
+        ifstream file(filename, ios::binary);
+        if (!file.is_open())
+        {
+            throw FileAccessException("Cannot open file for reading: " + filename);
+        }
+
+        // Get file size
+        file.seekg(0, ios::end);
+        size_t size = file.tellg();
+        file.seekg(0, ios::beg);
+
+        // Read file data
+        vector<unsigned char> data(size);
+        file.read(reinterpret_cast<char *>(data.data()), size);
+
+        if (!file)
+        {
+            throw FileAccessException("Error reading file: " + filename);
+        }
+
+        file.close();
+        return data;
+    }
+
+    static void writeFile(const string &filename, const vector<unsigned char> &data)
+    {
+        ofstream file(filename, ios::binary);
+        if (!file.is_open())
+        {
+            throw FileAccessException("Cannot create output file: " + filename);
+        }
+
+        file.write(reinterpret_cast<const char *>(data.data()), data.size());
+
+        if (!file)
+        {
+            throw FileAccessException("Error writing to file: " + filename);
+        }
+
+        file.close();
+    }
+
+    // Like writeFile, but only the owner may read the result (secret keys).
+    // An existing file is replaced rather than rewritten, so it never holds
+    // the new contents under its old permissions.
+    static void writePrivateFile(const string &filename, const vector<unsigned char> &data)
+    {
+#ifdef _WIN32
+        writeFile(filename, data);
+#else
+        remove(filename.c_str());
+        mode_t previous = umask(077);
+        try
+        {
+            writeFile(filename, data);
+        }
+        catch (...)
+        {
+            umask(previous);
+            throw;
+        }
+        umask(previous);
+        if (chmod(filename.c_str(), 0600) != 0)
+        {
+            throw FileAccessException("Cannot restrict permissions of " + filename);
+        }
+#endif
+    }
+
+    static void appendFile(const string &filename, const vector<const vector<unsigned char> *> &parts)
+    {
+        ofstream file(filename, ios::binary | ios::app);
+        if (!file.is_open())
+        {
+            throw FileAccessException("Cannot open output file for writing: " + filename);
+        }
+
+        for (size_t i = 0; i < parts.size(); i++)
+        {
+            file.write(reinterpret_cast<const char *>(parts[i]->data()), parts[i]->size());
+        }
+
+        if (!file)
+        {
+            throw FileAccessException("Error writing to file: " + filename);
+        }
+
+        file.close();
+    }
+
+    // Cuts a file back to its first `size` bytes
+    static void truncateFile(const string &filename, size_t size)
+    {
+#ifdef _WIN32
+        vector<unsigned char> data = readFile(filename);
+        data.resize(min(size, data.size()));
+        writeFile(filename, data);
+#else
+        if (truncate(filename.c_str(), static_cast<off_t>(size)) != 0)
+        {
+            throw FileAccessException("Error writing to file: " + filename);
+        }
+#endif
+    }
+
+    enum CopyMethod
+    {
+        COPY_REFLINK,
+        COPY_RANGE,
+        COPY_STREAM
+    };
+
+    static const char *copyMethodName(CopyMethod method)
+    {
+        switch (method)
+        {
+        case COPY_REFLINK:
+            return "reflink (shared extents)";
+        case COPY_RANGE:
+            return "copy_file_range";
+        default:
+            return "streaming copy";
+        }
+    }
+
+    // Creates destination as a copy of source. On Linux a reflink (FICLONE,
+    // XFS/Btrfs) is tried first so no data blocks are written, then
+    // copy_file_range, then a buffered streaming copy.
+    static CopyMethod cloneFile(const string &source, const string &destination)
+    {
+#ifdef __linux__
+        int in = open(source.c_str(), O_RDONLY | O_CLOEXEC);
+        if (in < 0)
+        {
+            throw FileAccessException("Cannot open file for reading: " + source);
+        }
+        int out = open(destination.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (out < 0)
+        {
+            close(in);
+            throw FileAccessException("Cannot create output file: " + destination);
+        }
+
+        CopyMethod method;
+        bool ok = copyDescriptor(in, out, method);
+
+        close(in);
+        if (close(out) != 0 || !ok)
+        {
+            throw FileAccessException("Error writing to file: " + destination);
+        }
+        return method;
+#else
+        ifstream in(source, ios::binary);
+        if (!in.is_open())
+        {
+            throw FileAccessException("Cannot open file for reading: " + source);
+        }
+        ofstream out(destination, ios::binary);
+        if (!out.is_open())
+        {
+            throw FileAccessException("Cannot create output file: " + destination);
+        }
+        out << in.rdbuf();
+        if (!out)
+        {
+            throw FileAccessException("Error writing to file: " + destination);
+        }
+        return COPY_STREAM;
+#endif
+    }
+
+#ifdef __linux__
+    // Copies an open source into an empty destination, trying the same
+    // methods as cloneFile; copies from the source's current offset
+    // buffer, when given, is used by the streaming fallback instead of a heap
+    // buffer of COPY_BUFFER_SIZE
+    static bool copyDescriptor(int in, int out, CopyMethod &method, char *buffer = NULL, size_t bufferSize = 0)
+    {
+        method = COPY_REFLINK;
+        if (ioctl(out, FICLONE, in) == 0)
+        {
+            return true;
+        }
+        method = COPY_RANGE;
+        int result = copyRange(in, out);
+        if (result >= 0)
+        {
+            return result > 0;
+        }
+        method = COPY_STREAM;
+        if (buffer != NULL)
+        {
+            return streamCopy(in, out, buffer, bufferSize);
+        }
+        vector<char> heapBuffer(Config::COPY_BUFFER_SIZE);
+        return streamCopy(in, out, heapBuffer.data(), heapBuffer.size());
+    }
+
+private:
+    // Returns 1 on success, 0 on I/O error, -1 if unsupported before any byte moved
+    static int copyRange(int in, int out)
+    {
+        bool copiedAny = false;
+        while (true)
+        {
+            ssize_t n = copy_file_range(in, NULL, out, NULL, Config::COPY_BUFFER_SIZE * 64, 0);
+            if (n == 0)
+            {
+                return 1;
+            }
+            if (n < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                bool unsupported = errno == ENOSYS || errno == EXDEV || errno == EINVAL ||
+                                   errno == EOPNOTSUPP || errno == EBADF;
+                if (!copiedAny && unsupported)
+                {
+                    return -1;
+                }
+                STEGO_PROBE3(chunk_done, "copy_range", 0, false);
+                return 0;
+            }
+            copiedAny = true;
+            STEGO_PROBE3(chunk_done, "copy_range", n, true);
+        }
+    }
+
+    static bool streamCopy(int in, int out, char *buffer, size_t bufferSize)
+    {
+        while (true)
+        {
+            ssize_t n = read(in, buffer, bufferSize);
+            if (n == 0)
+            {
+                return true;
+            }
+            if (n < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                return false;
+            }
+            for (ssize_t done = 0; done < n;)
+            {
+                ssize_t w = write(out, buffer + done, n - done);
+                if (w < 0)
+                {
+                    if (errno == EINTR)
+                    {
+                        continue;
+                    }
+                    STEGO_PROBE3(chunk_done, "stream_copy", done, false);
+                    return false;
+                }
+                done += w;
+            }
+            STEGO_PROBE3(chunk_done, "stream_copy", n, true);
+        }
+    }
+#endif
+};
+
+#ifdef __linux__
+// Closes a descriptor when the owning scope unwinds
+class ScopedFd
+{
+private:
+    int fd;
+
+    ScopedFd(const ScopedFd &);
+    ScopedFd &operator=(const ScopedFd &);
+
+public:
+    explicit ScopedFd(int descriptor) : fd(descriptor) {}
+
+    ~ScopedFd()
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+    }
+
+    int get() const
+    {
+        return fd;
+    }
+
+    // Closes now and reports errors, which for a written file may be the
+    // first sign of a failed write
+    bool closeNow()
+    {
+        int result = close(fd);
+        fd = -1;
+        return result == 0;
+    }
+};
+#endif
+
+// Positional I/O for engines that touch a few fixed-size pages of a large
+// file: pread/pwrite on Linux, seek + read/write elsewhere.
+class PageFile
+{
+private:
+    string path;
+#ifdef __linux__
+    int fd;
+#else
+    fstream file;
+#endif
+
+    PageFile(const PageFile &);
+    PageFile &operator=(const PageFile &);
+
+public:
+    PageFile(const string &filename, bool writable) : path(filename)
+    {
+#ifdef __linux__
+        fd = open(filename.c_str(), (writable ? O_RDWR : O_RDONLY) | O_CLOEXEC);
+        if (fd < 0)
+#else
+        file.open(filename, writable ? ios::in | ios::out | ios::binary : ios::in | ios::binary);
+        if (!file.is_open())
+#endif
+        {
+            throw FileAccessException(string(writable ? "Cannot open file for writing: "
+                                                      : "Cannot open file for reading: ") +
+                                      filename);
+        }
+    }
+
+    ~PageFile()
+    {
+#ifdef __linux__
+        close(fd);
+#endif
+    }
+
+    // Returns false on a short read (offset past the end of the file)
+    bool readAt(uint64_t offset, unsigned char *buffer, size_t length)
+    {
+#ifdef __linux__
+        size_t done = 0;
+        while (done < length)
+        {
+            ssize_t n = pread(fd, buffer + done, length - done, static_cast<off_t>(offset + done));
+            if (n < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (n <= 0)
+            {
+                return false;
+            }
+            done += static_cast<size_t>(n);
+        }
+        return true;
+#else
+        file.clear();
+        file.seekg(static_cast<streamoff>(offset));
+        file.read(reinterpret_cast<char *>(buffer), length);
+        return file.gcount() == static_cast<streamsize>(length);
+#endif
+    }
+
+    void writeAt(uint64_t offset, const unsigned char *buffer, size_t length)
+    {
+#ifdef __linux__
+        size_t done = 0;
+        while (done < length)
+        {
+            ssize_t n = pwrite(fd, buffer + done, length - done, static_cast<off_t>(offset + done));
+            if (n < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (n <= 0)
+            {
+                throw FileAccessException("Error writing to file: " + path);
+            }
+            done += static_cast<size_t>(n);
+        }
+#else
+        file.clear();
+        file.seekp(static_cast<streamoff>(offset));
+        file.write(reinterpret_cast<const char *>(buffer), length);
+        if (!file.flush())
+        {
+            throw FileAccessException("Error writing to file: " + path);
+        }
+#endif
+    }
+};
+
+// ============================================================================
+// STEGO STREAM COLLECTOR
+// ============================================================================
+// Pixel and sample engines carry header + payload + extensions as one bit
+// stream starting at the first usable sample. The collector tells the engine
+// when to stop reading, so extraction cost follows payload size, not cover size.
+// Given a filename, it also stops right after a header that names another file.
+class StegoStreamCollector
+{
+private:
+    vector<unsigned char> &stream;
+    const char *expected;
+    size_t wanted;
+    bool haveHeader;
+    bool haveExtensionHeader;
+    bool invalid;
+
+public:
+    explicit StegoStreamCollector(vector<unsigned char> &out, const char *expectedName = NULL)
+        : stream(out), expected(expectedName), wanted(sizeof(StegoHeader)), haveHeader(false),
+          haveExtensionHeader(false), invalid(false)
+    {
+        stream.clear();
+    }
+
+    // Returns false once no more bytes are needed
+    bool add(unsigned char byte)
+    {
+        stream.push_back(byte);
+        if (stream.size() < wanted)
+        {
+            return true;
+        }
+
+        if (!haveHeader)
+        {
+            StegoHeader header;
+            memcpy(&header, stream.data(), sizeof(header));
+            if (!header.validate() ||
+                (expected && (header.filenameLength != strlen(expected) ||
+                              memcmp(header.filename, expected, header.filenameLength) != 0)))
+            {
+                invalid = true;
+                return false;
+            }
+            haveHeader = true;
+            wanted += header.hiddenFileSize + sizeof(ExtensionBlockHeader);
+            return true;
+        }
+
+        if (!haveExtensionHeader)
+        {
+            ExtensionBlockHeader block;
+            memcpy(&block, stream.data() + wanted - sizeof(block), sizeof(block));
+            haveExtensionHeader = true;
+            if (block.magic == Config::EXTENSION_MAGIC)
+            {
+                wanted += block.totalLength;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // A valid header was read; the payload may still be cut short by the
+    // cover's capacity, which extractFile reports as a size mismatch
+    bool found() const
+    {
+        return haveHeader && !invalid;
+    }
+};
+
+// ============================================================================
+// CHANNEL PLANES
+// ============================================================================
+// Pixel engines keep the stream in channel-interleaved sample order, so what
+// defeats vector LSB loops is the stride: the alpha byte of RGBA pixels and
+// the second byte of 16-bit samples. These kernels split a tile into planes
+// (the carrier bytes and the rest), move stream bits in and out of a carrier
+// plane, and merge the planes back before the tile is written. SSSE3 and AVX2
+// versions are chosen at run time on GCC/Clang x86 builds.
+class ChannelPlanes
+{
+public:
+    enum Level
+    {
+        LEVEL_SCALAR,
+        LEVEL_SSSE3,
+        LEVEL_AVX2
+    };
+
+private:
+    static Level detect()
+    {
+#ifdef STEGO_HAVE_X86_SIMD
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+        {
+            return LEVEL_AVX2;
+        }
+        if (__builtin_cpu_supports("ssse3"))
+        {
+            return LEVEL_SSSE3;
+        }
+#endif
+        return LEVEL_SCALAR;
+    }
+
+    static Level &current()
+    {
+        static Level level = detected();
+        return level;
+    }
+
+    static void splitAlphaScalar(const unsigned char *rgba, size_t first, size_t pixels,
+                                 unsigned char *rgb, unsigned char *alpha)
+    {
+        for (size_t p = first; p < pixels; p++)
+        {
+            rgb[p * 3] = rgba[p * 4];
+            rgb[p * 3 + 1] = rgba[p * 4 + 1];
+            rgb[p * 3 + 2] = rgba[p * 4 + 2];
+            alpha[p] = rgba[p * 4 + 3];
+        }
+    }
+
+    static void mergeAlphaScalar(const unsigned char *rgb, const unsigned char *alpha, size_t first,
+                                 size_t pixels, unsigned char *rgba)
+    {
+        for (size_t p = first; p < pixels; p++)
+        {
+            rgba[p * 4] = rgb[p * 3];
+            rgba[p * 4 + 1] = rgb[p * 3 + 1];
+            rgba[p * 4 + 2] = rgb[p * 3 + 2];
+            rgba[p * 4 + 3] = alpha[p];
+        }
+    }
+
+    static void gatherBitsScalar(const unsigned char *plane, size_t first, size_t bytes, int shift,
+                                 unsigned char *out)
+    {
+        for (size_t j = first; j < bytes; j++)
+        {
+            unsigned char value = 0;
+            for (int b = 0; b < 8; b++)
+            {
+                value = static_cast<unsigned char>((value << 1) | ((plane[j * 8 + b] >> shift) & 1));
+            }
+            out[j] = value;
+        }
+    }
+
+    static void scatterBitsScalar(const unsigned char *in, size_t first, size_t bytes, int shift,
+                                  unsigned char *plane)
+    {
+        unsigned char keep = static_cast<unsigned char>(~(1u << shift));
+        for (size_t j = first; j < bytes; j++)
+        {
+            for (int b = 0; b < 8; b++)
+            {
+                unsigned char v = static_cast<unsigned char>((in[j] >> (7 - b)) & 1);
+                plane[j * 8 + b] = static_cast<unsigned char>((plane[j * 8 + b] & keep) | (v << shift));
+            }
+        }
+    }
+
+#ifdef STEGO_HAVE_X86_SIMD
+    // Each SIMD loop leaves a scalar tail and returns where it stopped.
+    // Stores may run past the current group, but never past the buffer.
+    STEGO_TARGET("ssse3")
+    static size_t splitAlphaSsse3(const unsigned char *rgba, size_t pixels, unsigned char *rgb, unsigned char *alpha)
+    {
+        const __m128i colour = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+        const __m128i opacity = _mm_setr_epi8(3, 7, 11, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+        size_t p = 0;
+        for (; p + 6 <= pixels; p += 4)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(rgba + p * 4));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(rgb + p * 3), _mm_shuffle_epi8(v, colour));
+            int a = _mm_cvtsi128_si32(_mm_shuffle_epi8(v, opacity));
+            memcpy(alpha + p, &a, 4);
+        }
+        return p;
+    }
+
+    STEGO_TARGET("avx2")
+    static size_t splitAlphaAvx2(const unsigned char *rgba, size_t pixels, unsigned char *rgb, unsigned char *alpha)
+    {
+        const __m256i shuffle = _mm256_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, 3, 7, 11, 15,
+                                                 0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, 3, 7, 11, 15);
+        const __m256i compact = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7);
+        size_t p = 0;
+        for (; p + 11 <= pixels; p += 8)
+        {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(rgba + p * 4));
+            v = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(v, shuffle), compact);
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(rgb + p * 3), v);
+            __m128i upper = _mm256_extracti128_si256(v, 1);
+            _mm_storel_epi64(reinterpret_cast<__m128i *>(alpha + p), _mm_unpackhi_epi64(upper, upper));
+        }
+        return p;
+    }
+
+    STEGO_TARGET("ssse3")
+    static size_t mergeAlphaSsse3(const unsigned char *rgb, const unsigned char *alpha, size_t pixels,
+                                  unsigned char *rgba)
+    {
+        const __m128i colour = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+        const __m128i opacity = _mm_setr_epi8(-1, -1, -1, 0, -1, -1, -1, 1, -1, -1, -1, 2, -1, -1, -1, 3);
+        size_t p = 0;
+        for (; p + 6 <= pixels; p += 4)
+        {
+            __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(rgb + p * 3));
+            int a;
+            memcpy(&a, alpha + p, 4);
+            __m128i v = _mm_or_si128(_mm_shuffle_epi8(c, colour), _mm_shuffle_epi8(_mm_cvtsi32_si128(a), opacity));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(rgba + p * 4), v);
+        }
+        return p;
+    }
+
+    STEGO_TARGET("avx2")
+    static size_t mergeAlphaAvx2(const unsigned char *rgb, const unsigned char *alpha, size_t pixels,
+                                 unsigned char *rgba)
+    {
+        const __m256i spread = _mm256_setr_epi32(0, 1, 2, 0, 3, 4, 5, 0);
+        const __m256i colour = _mm256_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+                                                0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+        size_t p = 0;
+        for (; p + 11 <= pixels; p += 8)
+        {
+            __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(rgb + p * 3));
+            c = _mm256_shuffle_epi8(_mm256_permutevar8x32_epi32(c, spread), colour);
+            __m256i a = _mm256_slli_epi32(
+                _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(alpha + p))), 24);
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(rgba + p * 4), _mm256_or_si256(c, a));
+        }
+        return p;
+    }
+
+    STEGO_TARGET("ssse3")
+    static size_t split16Ssse3(const unsigned char *samples, size_t count, unsigned char *low, unsigned char *high)
+    {
+        const __m128i bytes = _mm_setr_epi8(0, 2, 4, 6, 8, 10, 12, 14, 1, 3, 5, 7, 9, 11, 13, 15);
+        size_t i = 0;
+        for (; i + 16 <= count; i += 16)
+        {
+            const __m128i *in = reinterpret_cast<const __m128i *>(samples + i * 2);
+            __m128i a = _mm_shuffle_epi8(_mm_loadu_si128(in), bytes);
+            __m128i b = _mm_shuffle_epi8(_mm_loadu_si128(in + 1), bytes);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(low + i), _mm_unpacklo_epi64(a, b));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(high + i), _mm_unpackhi_epi64(a, b));
+        }
+        return i;
+    }
+
+    STEGO_TARGET("avx2")
+    static size_t split16Avx2(const unsigned char *samples, size_t count, unsigned char *low, unsigned char *high)
+    {
+        const __m256i bytes = _mm256_setr_epi8(0, 2, 4, 6, 8, 10, 12, 14, 1, 3, 5, 7, 9, 11, 13, 15,
+                                               0, 2, 4, 6, 8, 10, 12, 14, 1, 3, 5, 7, 9, 11, 13, 15);
+        size_t i = 0;
+        for (; i + 32 <= count; i += 32)
+        {
+            const __m256i *in = reinterpret_cast<const __m256i *>(samples + i * 2);
+            __m256i a = _mm256_shuffle_epi8(_mm256_loadu_si256(in), bytes);
+            __m256i b = _mm256_shuffle_epi8(_mm256_loadu_si256(in + 1), bytes);
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(low + i),
+                                _mm256_permute4x64_epi64(_mm256_unpacklo_epi64(a, b), 0xD8));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(high + i),
+                                _mm256_permute4x64_epi64(_mm256_unpackhi_epi64(a, b), 0xD8));
+        }
+        return i;
+    }
+
+    STEGO_TARGET("ssse3")
+    static size_t merge16Ssse3(const unsigned char *low, const unsigned char *high, size_t count, unsigned char *samples)
+    {
+        size_t i = 0;
+        for (; i + 16 <= count; i += 16)
+        {
+            __m128i l = _mm_loadu_si128(reinterpret_cast<const __m128i *>(low + i));
+            __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i *>(high + i));
+            __m128i *out = reinterpret_cast<__m128i *>(samples + i * 2);
+            _mm_storeu_si128(out, _mm_unpacklo_epi8(l, h));
+            _mm_storeu_si128(out + 1, _mm_unpackhi_epi8(l, h));
+        }
+        return i;
+    }
+
+    STEGO_TARGET("avx2")
+    static size_t merge16Avx2(const unsigned char *low, const unsigned char *high, size_t count, unsigned char *samples)
+    {
+        size_t i = 0;
+        for (; i + 32 <= count; i += 32)
+        {
+            __m256i l = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(low + i));
+            __m256i h = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(high + i));
+            __m256i first = _mm256_unpacklo_epi8(l, h);
+            __m256i second = _mm256_unpackhi_epi8(l, h);
+            __m256i *out = reinterpret_cast<__m256i *>(samples + i * 2);
+            _mm256_storeu_si256(out, _mm256_permute2x128_si256(first, second, 0x20));
+            _mm256_storeu_si256(out + 1, _mm256_permute2x128_si256(first, second, 0x31));
+        }
+        return i;
+    }
+
+    // The carrier bit is shifted up to the byte's top bit; byte order is
+    // reversed within each group of 8 so the first sample lands in bit 7
+    STEGO_TARGET("ssse3")
+    static size_t gatherBitsSsse3(const unsigned char *plane, size_t bytes, int shift, unsigned char *out)
+    {
+        const __m128i reverse = _mm_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+        const __m128i up = _mm_cvtsi32_si128(7 - shift);
+        size_t j = 0;
+        for (; j + 2 <= bytes; j += 2)
+        {
+            __m128i v = _mm_sll_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(plane + j * 8)), up);
+            uint16_t bits = static_cast<uint16_t>(_mm_movemask_epi8(_mm_shuffle_epi8(v, reverse)));
+            memcpy(out + j, &bits, 2);
+        }
+        return j;
+    }
+
+    STEGO_TARGET("avx2")
+    static size_t gatherBitsAvx2(const unsigned char *plane, size_t bytes, int shift, unsigned char *out)
+    {
+        const __m256i reverse = _mm256_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8,
+                                                 7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+        const __m128i up = _mm_cvtsi32_si128(7 - shift);
+        size_t j = 0;
+        for (; j + 4 <= bytes; j += 4)
+        {
+            __m256i v = _mm256_sll_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(plane + j * 8)), up);
+            uint32_t bits = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_shuffle_epi8(v, reverse)));
+            memcpy(out + j, &bits, 4);
+        }
+        return j;
+    }
+
+    STEGO_TARGET("ssse3")
+    static size_t scatterBitsSsse3(const unsigned char *in, size_t bytes, int shift, unsigned char *plane)
+    {
+        const __m128i spread = _mm_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1);
+        const __m128i select = _mm_setr_epi8(-128, 64, 32, 16, 8, 4, 2, 1, -128, 64, 32, 16, 8, 4, 2, 1);
+        const __m128i carrier = _mm_set1_epi8(static_cast<char>(1 << shift));
+        size_t j = 0;
+        for (; j + 2 <= bytes; j += 2)
+        {
+            uint16_t pair;
+            memcpy(&pair, in + j, 2);
+            __m128i bits = _mm_shuffle_epi8(_mm_cvtsi32_si128(pair), spread);
+            bits = _mm_cmpeq_epi8(_mm_and_si128(bits, select), select);
+            __m128i *p = reinterpret_cast<__m128i *>(plane + j * 8);
+            __m128i v = _mm_andnot_si128(carrier, _mm_loadu_si128(p));
+            _mm_storeu_si128(p, _mm_or_si128(v, _mm_and_si128(bits, carrier)));
+        }
+        return j;
+    }
+
+    STEGO_TARGET("avx2")
+    static size_t scatterBitsAvx2(const unsigned char *in, size_t bytes, int shift, unsigned char *plane)
+    {
+        const __m256i spread = _mm256_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1,
+                                                2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3);
+        const __m256i select = _mm256_setr_epi8(-128, 64, 32, 16, 8, 4, 2, 1, -128, 64, 32, 16, 8, 4, 2, 1,
+                                                -128, 64, 32, 16, 8, 4, 2, 1, -128, 64, 32, 16, 8, 4, 2, 1);
+        const __m256i carrier = _mm256_set1_epi8(static_cast<char>(1 << shift));
+        size_t j = 0;
+        for (; j + 4 <= bytes; j += 4)
+        {
+            int quad;
+            memcpy(&quad, in + j, 4);
+            __m256i bits = _mm256_shuffle_epi8(_mm256_set1_epi32(quad), spread);
+            bits = _mm256_cmpeq_epi8(_mm256_and_si256(bits, select), select);
+            __m256i *p = reinterpret_cast<__m256i *>(plane + j * 8);
+            __m256i v = _mm256_andnot_si256(carrier, _mm256_loadu_si256(p));
+            _mm256_storeu_si256(p, _mm256_or_si256(v, _mm256_and_si256(bits, carrier)));
+        }
+        return j;
+    }
+#endif
+
+public:
+    static Level detected()
+    {
+        static const Level level = detect();
+        return level;
+    }
+
+    static Level level()
+    {
+        return current();
+    }
+
+    // Caps the kernels at a lower level; the benchmark compares them this way
+    static void setLevel(Level cap)
+    {
+        current() = min(cap, detected());
+    }
+
+    static const char *levelName(Level level)
+    {
+        static const char *const names[] = {"scalar", "ssse3", "avx2"};
+        return names[level];
+    }
+
+    // RGBA pixels -> packed RGB plane (3 bytes per pixel) + alpha plane
+    static void splitAlpha(const unsigned char *rgba, size_t pixels, unsigned char *rgb, unsigned char *alpha)
+    {
+        size_t done = 0;
+#ifdef STEGO_HAVE_X86_SIMD
+        if (level() == LEVEL_AVX2)
+        {
+            done = splitAlphaAvx2(rgba, pixels, rgb, alpha);
+        }
+        else if (level() == LEVEL_SSSE3)
+        {
+            done = splitAlphaSsse3(rgba, pixels, rgb, alpha);
+        }
+#endif
+        splitAlphaScalar(rgba, done, pixels, rgb, alpha);
+    }
+
+    static void mergeAlpha(const unsigned char *rgb, const unsigned char *alpha, size_t pixels, unsigned char *rgba)
+    {
+        size_t done = 0;
+#ifdef STEGO_HAVE_X86_SIMD
+        if (level() == LEVEL_AVX2)
+        {
+            done = mergeAlphaAvx2(rgb, alpha, pixels, rgba);
+        }
+        else if (level() == LEVEL_SSSE3)
+        {
+            done = mergeAlphaSsse3(rgb, alpha, pixels, rgba);
+        }
+#endif
+        mergeAlphaScalar(rgb, alpha, done, pixels, rgba);
+    }
+
+    // Little-endian 16-bit samples -> low byte plane + high byte plane
+    static void split16(const unsigned char *samples, size_t count, unsigned char *low, unsigned char *high)
+    {
+        size_t i = 0;
+#ifdef STEGO_HAVE_X86_SIMD
+        if (level() == LEVEL_AVX2)
+        {
+            i = split16Avx2(samples, count, low, high);
+        }
+        else if (level() == LEVEL_SSSE3)
+        {
+            i = split16Ssse3(samples, count, low, high);
+        }
+#endif
+        for (; i < count; i++)
+        {
+            low[i] = samples[i * 2];
+            high[i] = samples[i * 2 + 1];
+        }
+    }
+
+    static void merge16(const unsigned char *low, const unsigned char *high, size_t count, unsigned char *samples)
+    {
+        size_t i = 0;
+#ifdef STEGO_HAVE_X86_SIMD
+        if (level() == LEVEL_AVX2)
+        {
+            i = merge16Avx2(low, high, count, samples);
+        }
+        else if (level() == LEVEL_SSSE3)
+        {
+            i = merge16Ssse3(low, high, count, samples);
+        }
+#endif
+        for (; i < count; i++)
+        {
+            samples[i * 2] = low[i];
+            samples[i * 2 + 1] = high[i];
+        }
+    }
+
+    // Bit `shift` of 8 consecutive plane bytes -> one stream byte, first
+    // byte in the most significant bit
+    static void gatherBits(const unsigned char *plane, size_t bytes, int shift, unsigned char *out)
+    {
+        size_t done = 0;
+#ifdef STEGO_HAVE_X86_SIMD
+        if (level() == LEVEL_AVX2)
+        {
+            done = gatherBitsAvx2(plane, bytes, shift, out);
+        }
+        else if (level() == LEVEL_SSSE3)
+        {
+            done = gatherBitsSsse3(plane, bytes, shift, out);
+        }
+#endif
+        gatherBitsScalar(plane, done, bytes, shift, out);
+    }
+
+    static void scatterBits(const unsigned char *in, size_t bytes, int shift, unsigned char *plane)
+    {
+        size_t done = 0;
+#ifdef STEGO_HAVE_X86_SIMD
+        if (level() == LEVEL_AVX2)
+        {
+            done = scatterBitsAvx2(in, bytes, shift, plane);
+        }
+        else if (level() == LEVEL_SSSE3)
+        {
+            done = scatterBitsSsse3(in, bytes, shift, plane);
+        }
+#endif
+        scatterBitsScalar(in, done, bytes, shift, plane);
+    }
+};
+
+// ============================================================================
+// QOI HOST ENGINE
+// ============================================================================
+// Hides the stego stream (header + payload + extensions) in the least
+// significant bit of R, G and B of a QOI image; alpha is left untouched.
+// Decoding, embedding and re-encoding are fused into one streaming pass over
+// small pixel tiles, so no full pixel buffer is ever held in memory.
+struct QoiPixel
+{
+    unsigned char r, g, b, a;
+};
+
+static_assert(sizeof(QoiPixel) == 4, "QoiPixel tiles are handled as interleaved RGBA bytes");
+
+struct QoiImageInfo
+{
+    uint32_t width;
+    uint32_t height;
+    unsigned char channels;
+    unsigned char colorspace;
+
+    uint64_t pixelCount() const { return static_cast<uint64_t>(width) * height; }
+};
+
+class QoiDecoder
+{
+private:
+    istream &in;
+    vector<unsigned char> buffer;
+    size_t pos;
+    size_t end;
+    QoiPixel index[64];
+    QoiPixel prev;
+    int run;
+    uint64_t remaining;
+
+    // Keeps at least 5 bytes (the longest op) buffered, so op decoding
+    // needs no per-byte bounds checks
+    void refill()
+    {
+        size_t left = end - pos;
+        memmove(buffer.data(), buffer.data() + pos, left);
+        in.read(reinterpret_cast<char *>(buffer.data() + left), Config::QOI_IO_BUFFER_SIZE - left);
+        pos = 0;
+        end = left + static_cast<size_t>(in.gcount());
+        memset(buffer.data() + end, 0, buffer.size() - end);
+    }
+
+public:
+    QoiDecoder(istream &input, const QoiImageInfo &info)
+        : in(input), buffer(Config::QOI_IO_BUFFER_SIZE + 8), pos(0), end(0), run(0),
+          remaining(info.pixelCount())
+    {
+        memset(index, 0, sizeof(index));
+        prev.r = prev.g = prev.b = 0;
+        prev.a = 255;
+    }
+
+    bool next(QoiPixel &px)
+    {
+        if (remaining == 0)
+        {
+            return false;
+        }
+        remaining--;
+
+        if (run > 0)
+        {
+            run--;
+            px = prev;
+            return true;
+        }
+
+        // Near the end of the input the op itself may be cut short
+        if (end - pos < 5)
+        {
+            refill();
+            if (pos == end)
+            {
+                throw InvalidFormatException("Truncated QOI pixel data");
+            }
+            unsigned char op = buffer[pos];
+            size_t length = op == Config::QOI_OP_RGBA ? 5 : op == Config::QOI_OP_RGB ? 4
+                                                        : op < 0x80 || op >= 0xc0  ? 1
+                                                                                    : 2;
+            if (end - pos < length)
+            {
+                throw InvalidFormatException("Truncated QOI pixel data");
+            }
+        }
+
+        const unsigned char *p = buffer.data() + pos;
+        unsigned char b1 = p[0];
+        if (b1 == Config::QOI_OP_RGB)
+        {
+            prev.r = p[1];
+            prev.g = p[2];
+            prev.b = p[3];
+            pos += 4;
+        }
+        else if (b1 == Config::QOI_OP_RGBA)
+        {
+            prev.r = p[1];
+            prev.g = p[2];
+            prev.b = p[3];
+            prev.a = p[4];
+            pos += 5;
+        }
+        else
+        {
+            switch (b1 >> 6)
+            {
+            case 0: // INDEX
+                prev = index[b1];
+                pos += 1;
+                break;
+            case 1: // DIFF
+                prev.r += ((b1 >> 4) & 3) - 2;
+                prev.g += ((b1 >> 2) & 3) - 2;
+                prev.b += (b1 & 3) - 2;
+                pos += 1;
+                break;
+            case 2: // LUMA
+            {
+                int vg = (b1 & 0x3f) - 32;
+                prev.r += vg - 8 + ((p[1] >> 4) & 0x0f);
+                prev.g += vg;
+                prev.b += vg - 8 + (p[1] & 0x0f);
+                pos += 2;
+                break;
+            }
+            default: // RUN
+                run = b1 & 0x3f;
+                pos += 1;
+                break;
+            }
+        }
+
+        index[(prev.r * 3 + prev.g * 5 + prev.b * 7 + prev.a * 11) % 64] = prev;
+        px = prev;
+        return true;
+    }
+
+    // Decodes up to `count` pixels; returns how many were decoded
+    size_t nextTile(QoiPixel *tile, size_t count)
+    {
+        size_t n = 0;
+        while (n < count && next(tile[n]))
+        {
+            n++;
+        }
+        return n;
+    }
+};
+
+class QoiEncoder
+{
+private:
+    ostream &out;
+    vector<unsigned char> buffer;
+    size_t pos;
+    QoiPixel index[64];
+    QoiPixel prev;
+    int run;
+
+    void flushRun()
+    {
+        if (run > 0)
+        {
+            buffer[pos++] = static_cast<unsigned char>(Config::QOI_OP_RUN | (run - 1));
+            run = 0;
+        }
+    }
+
+    void flushBuffer()
+    {
+        out.write(reinterpret_cast<const char *>(buffer.data()), pos);
+        pos = 0;
+    }
+
+public:
+    QoiEncoder(ostream &output)
+        : out(output), buffer(Config::QOI_IO_BUFFER_SIZE + 8), pos(0), run(0)
+    {
+        memset(index, 0, sizeof(index));
+        prev.r = prev.g = prev.b = 0;
+        prev.a = 255;
+    }
+
+    static void writeHeader(ostream &output, const QoiImageInfo &info)
+    {
+        unsigned char header[Config::QOI_HEADER_SIZE];
+        memcpy(header, "qoif", 4);
+        for (int i = 0; i < 4; i++)
+        {
+            header[4 + i] = static_cast<unsigned char>(info.width >> (24 - 8 * i));
+            header[8 + i] = static_cast<unsigned char>(info.height >> (24 - 8 * i));
+        }
+        header[12] = info.channels;
+        header[13] = info.colorspace;
+        output.write(reinterpret_cast<const char *>(header), sizeof(header));
+    }
+
+    void put(const QoiPixel &px)
+    {
+        if (pos > Config::QOI_IO_BUFFER_SIZE - 8)
+        {
+            flushBuffer();
+        }
+
+        if (memcmp(&px, &prev, sizeof(px)) == 0)
+        {
+            if (++run == 62)
+            {
+                flushRun();
+            }
+            return;
+        }
+        flushRun();
+
+        int hash = (px.r * 3 + px.g * 5 + px.b * 7 + px.a * 11) % 64;
+        if (memcmp(&index[hash], &px, sizeof(px)) == 0)
+        {
+            buffer[pos++] = static_cast<unsigned char>(Config::QOI_OP_INDEX | hash);
+        }
+        else
+        {
+            index[hash] = px;
+            if (px.a == prev.a)
+            {
+                signed char vr = static_cast<signed char>(px.r - prev.r);
+                signed char vg = static_cast<signed char>(px.g - prev.g);
+                signed char vb = static_cast<signed char>(px.b - prev.b);
+                signed char vgr = static_cast<signed char>(vr - vg);
+                signed char vgb = static_cast<signed char>(vb - vg);
+
+                if (vr > -3 && vr < 2 && vg > -3 && vg < 2 && vb > -3 && vb < 2)
+                {
+                    buffer[pos++] = static_cast<unsigned char>(
+                        Config::QOI_OP_DIFF | (vr + 2) << 4 | (vg + 2) << 2 | (vb + 2));
+                }
+                else if (vgr > -9 && vgr < 8 && vg > -33 && vg < 32 && vgb > -9 && vgb < 8)
+                {
+                    buffer[pos++] = static_cast<unsigned char>(Config::QOI_OP_LUMA | (vg + 32));
+                    buffer[pos++] = static_cast<unsigned char>((vgr + 8) << 4 | (vgb + 8));
+                }
+                else
+                {
+                    buffer[pos++] = Config::QOI_OP_RGB;
+                    buffer[pos++] = px.r;
+                    buffer[pos++] = px.g;
+                    buffer[pos++] = px.b;
+                }
+            }
+            else
+            {
+                buffer[pos++] = Config::QOI_OP_RGBA;
+                buffer[pos++] = px.r;
+                buffer[pos++] = px.g;
+                buffer[pos++] = px.b;
+                buffer[pos++] = px.a;
+            }
+        }
+        prev = px;
+    }
+
+    void finish()
+    {
+        static const unsigned char padding[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+        flushRun();
+        flushBuffer();
+        out.write(reinterpret_cast<const char *>(padding), sizeof(padding));
+    }
+};
+
+class QoiEngine
+{
+private:
+    static QoiImageInfo readHeader(istream &in, const string &filename)
+    {
+        unsigned char header[Config::QOI_HEADER_SIZE];
+        in.read(reinterpret_cast<char *>(header), sizeof(header));
+        if (in.gcount() != static_cast<streamsize>(sizeof(header)) || memcmp(header, "qoif", 4) != 0)
+        {
+            throw InvalidFormatException("Not a QOI image: " + filename);
+        }
+
+        QoiImageInfo info;
+        info.width = 0;
+        info.height = 0;
+        for (int i = 0; i < 4; i++)
+        {
+            info.width = (info.width << 8) | header[4 + i];
+            info.height = (info.height << 8) | header[8 + i];
+        }
+        info.channels = header[12];
+        info.colorspace = header[13];
+
+        if (info.width == 0 || info.height == 0 || info.pixelCount() > Config::QOI_MAX_PIXELS ||
+            (info.channels != 3 && info.channels != 4))
+        {
+            throw InvalidFormatException("Unsupported QOI header: " + filename);
+        }
+        return info;
+    }
+
+    static QoiImageInfo open(ifstream &in, const string &filename)
+    {
+        in.open(filename, ios::binary);
+        if (!in.is_open())
+        {
+            throw FileAccessException("Cannot open file for reading: " + filename);
+        }
+        return readHeader(in, filename);
+    }
+
+public:
+    // Bytes of stego stream the image can carry (1 bit per colour channel)
+    static size_t capacity(const string &filename)
+    {
+        ifstream in;
+        QoiImageInfo info = open(in, filename);
+        return static_cast<size_t>(info.pixelCount() * 3 / 8);
+    }
+
+    static void embed(const string &coverPath, const string &outputPath, const vector<unsigned char> &stream)
+    {
+        ifstream in;
+        QoiImageInfo info = open(in, coverPath);
+        if (stream.size() > info.pixelCount() * 3 / 8)
+        {
+            throw FileSizeException("Hidden data exceeds the QOI image capacity");
+        }
+
+        ofstream out(outputPath, ios::binary);
+        if (!out.is_open())
+        {
+            throw FileAccessException("Cannot create output file: " + outputPath);
+        }
+
+        QoiDecoder decoder(in, info);
+        QoiEncoder encoder(out);
+        QoiEncoder::writeHeader(out, info);
+
+        // The LSB kernel runs on the tile's RGB plane, without the alpha
+        // stride; a full tile carries a whole number of stream bytes
+        vector<QoiPixel> tile(Config::QOI_TILE_PIXELS);
+        vector<unsigned char> rgb(tile.size() * 3);
+        vector<unsigned char> alpha(tile.size());
+        unsigned char *pixels = reinterpret_cast<unsigned char *>(tile.data());
+        size_t done = 0;
+        size_t n;
+        while ((n = decoder.nextTile(tile.data(), tile.size())) > 0)
+        {
+            size_t bytes = min(stream.size() - done, n * 3 / 8);
+            if (bytes > 0)
+            {
+                ChannelPlanes::splitAlpha(pixels, n, rgb.data(), alpha.data());
+                ChannelPlanes::scatterBits(stream.data() + done, bytes, 0, rgb.data());
+                ChannelPlanes::mergeAlpha(rgb.data(), alpha.data(), n, pixels);
+                done += bytes;
+            }
+            for (size_t i = 0; i < n; i++)
+            {
+                encoder.put(tile[i]);
+            }
+            STEGO_PROBE3(chunk_done, "qoi_tile", n, out.good());
+        }
+        encoder.finish();
+
+        if (!out)
+        {
+            throw FileAccessException("Error writing to file: " + outputPath);
+        }
+    }
+
+    // Reads the stego stream back; decoding stops as soon as the header,
+    // payload and any extension block have been recovered.
+    static bool extract(const string &filename, vector<unsigned char> &stream, const char *expectedName = NULL)
+    {
+        ifstream in;
+        QoiImageInfo info = open(in, filename);
+        QoiDecoder decoder(in, info);
+
+        StegoStreamCollector collector(stream, expectedName);
+        vector<QoiPixel> tile(Config::QOI_TILE_PIXELS);
+        vector<unsigned char> rgb(tile.size() * 3);
+        vector<unsigned char> alpha(tile.size());
+        vector<unsigned char> bytes(tile.size() * 3 / 8);
+        const unsigned char *pixels = reinterpret_cast<const unsigned char *>(tile.data());
+        bool more = true;
+        size_t n;
+        while (more && (n = decoder.nextTile(tile.data(), tile.size())) > 0)
+        {
+            size_t count = n * 3 / 8;
+            ChannelPlanes::splitAlpha(pixels, n, rgb.data(), alpha.data());
+            ChannelPlanes::gatherBits(rgb.data(), count, 0, bytes.data());
+            for (size_t i = 0; i < count && more; i++)
+            {
+                more = collector.add(bytes[i]);
+            }
+        }
+        return collector.found();
+    }
+};
+
+// ============================================================================
+// FLOAT IMAGE HOST ENGINE
+// ============================================================================
+// Hides the stego stream in the low mantissa bits of IEEE float samples of
+// uncompressed scanline OpenEXR and float TIFF images. Only normal numbers
+// carry data: zeros, subnormals, Inf and NaN are left bit-exact, and the
+// exponent is never touched, so every changed sample stays within
+// 2^(k - mantissaBits) relative error of the original value, whatever its
+// exponent range (float32: k = 4 -> 2^-19, half: k = 1 -> 2^-10).
+struct FloatRegion
+{
+    size_t offset;
+    size_t count;
+    unsigned char sampleBits;
+    bool bigEndian;
+};
+
+// What the layout parsers read from: a loaded file, or positioned reads of
+// just the header and tables when a cover is only being detected
+class FloatLayoutSource
+{
+private:
+    const vector<unsigned char> *data;
+    PageFile *file;
+    size_t fileSize;
+
+public:
+    explicit FloatLayoutSource(const vector<unsigned char> &loaded)
+        : data(&loaded), file(NULL), fileSize(loaded.size()) {}
+
+    FloatLayoutSource(PageFile &opened, size_t size) : data(NULL), file(&opened), fileSize(size) {}
+
+    size_t size() const
+    {
+        return fileSize;
+    }
+
+    // Returns false when the range runs past the end of the file
+    bool read(size_t pos, size_t length, vector<unsigned char> &out) const
+    {
+        if (pos > fileSize || length > fileSize - pos)
+        {
+            return false;
+        }
+        if (data)
+        {
+            out.assign(data->begin() + pos, data->begin() + pos + length);
+            return true;
+        }
+        out.resize(length);
+        return file->readAt(pos, out.data(), length);
+    }
+};
+
+class FloatImageEngine
+{
+private:
+    static const size_t BLOCK = 256;
+
+    static uint32_t read32(const vector<unsigned char> &d, size_t pos, bool bigEndian)
+    {
+        if (bigEndian)
+            return (uint32_t(d[pos]) << 24) | (uint32_t(d[pos + 1]) << 16) | (uint32_t(d[pos + 2]) << 8) | d[pos + 3];
+        return (uint32_t(d[pos + 3]) << 24) | (uint32_t(d[pos + 2]) << 16) | (uint32_t(d[pos + 1]) << 8) | d[pos];
+    }
+
+    static uint16_t read16(const vector<unsigned char> &d, size_t pos, bool bigEndian)
+    {
+        if (bigEndian)
+            return static_cast<uint16_t>((d[pos] << 8) | d[pos + 1]);
+        return static_cast<uint16_t>((d[pos + 1] << 8) | d[pos]);
+    }
+
+    static int embedBits(const FloatRegion &region)
+    {
+        return region.sampleBits == 32 ? Config::FLOAT32_EMBED_BITS : Config::HALF_EMBED_BITS;
+    }
+
+#ifdef STEGO_HAVE_X86_SIMD
+    // AVX2 kernels over 8 samples at a time; each returns how many samples it
+    // handled and the scalar loops finish the block
+    STEGO_TARGET("avx2")
+    static size_t loadBlockAvx2(const unsigned char *p, size_t n, int sampleBits, bool bigEndian,
+                                uint32_t *words, uint32_t *usable)
+    {
+        const __m256i swap32 = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+                                                3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+        const __m128i swap16 = _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+        const __m256i exponentMask = _mm256_set1_epi32(sampleBits == 32 ? 0xFF : 0x1F);
+        const __m256i one = _mm256_set1_epi32(1);
+        const __m128i exponentShift = _mm_cvtsi32_si128(sampleBits == 32 ? 23 : 10);
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8)
+        {
+            __m256i v;
+            if (sampleBits == 32)
+            {
+                v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + i * 4));
+                v = bigEndian ? _mm256_shuffle_epi8(v, swap32) : v;
+            }
+            else
+            {
+                __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i * 2));
+                v = _mm256_cvtepu16_epi32(bigEndian ? _mm_shuffle_epi8(h, swap16) : h);
+            }
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(words + i), v);
+            __m256i exponent = _mm256_and_si256(_mm256_srl_epi32(v, exponentShift), exponentMask);
+            __m256i special = _mm256_or_si256(_mm256_cmpeq_epi32(exponent, _mm256_setzero_si256()),
+                                              _mm256_cmpeq_epi32(exponent, exponentMask));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(usable + i), _mm256_andnot_si256(special, one));
+        }
+        return i;
+    }
+
+    STEGO_TARGET("avx2")
+    static size_t storeBlockAvx2(unsigned char *p, size_t n, int sampleBits, bool bigEndian, const uint32_t *words)
+    {
+        const __m256i swap32 = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+                                                3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+        const __m256i pack16 = bigEndian
+                                   ? _mm256_setr_epi8(1, 0, 5, 4, 9, 8, 13, 12, -1, -1, -1, -1, -1, -1, -1, -1,
+                                                      1, 0, 5, 4, 9, 8, 13, 12, -1, -1, -1, -1, -1, -1, -1, -1)
+                                   : _mm256_setr_epi8(0, 1, 4, 5, 8, 9, 12, 13, -1, -1, -1, -1, -1, -1, -1, -1,
+                                                      0, 1, 4, 5, 8, 9, 12, 13, -1, -1, -1, -1, -1, -1, -1, -1);
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8)
+        {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(words + i));
+            if (sampleBits == 32)
+            {
+                v = bigEndian ? _mm256_shuffle_epi8(v, swap32) : v;
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(p + i * 4), v);
+            }
+            else
+            {
+                v = _mm256_permute4x64_epi64(_mm256_shuffle_epi8(v, pack16), 0x08);
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(p + i * 2), _mm256_castsi256_si128(v));
+            }
+        }
+        return i;
+    }
+
+    // Lane form of the scalar merge: an in-register exclusive scan gives
+    // each sample its chunk, the two-byte window comes from a gather and a
+    // per-lane shift extracts the chunk. Bit positions are relative to the
+    // byte at `stream`; chunks at or past `limit` bits are left alone.
+    STEGO_TARGET("avx2")
+    static size_t mergeBlockAvx2(uint32_t *words, const uint32_t *usable, size_t n, const unsigned char *stream,
+                                 uint32_t bitOffset, uint32_t limit, int k, uint32_t &running)
+    {
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i low = _mm256_set1_epi32((1 << k) - 1);
+        const __m256i width = _mm256_set1_epi32(k);
+        const __m256i top = _mm256_set1_epi32(16 - k);
+        const __m256i offset = _mm256_set1_epi32(static_cast<int>(bitOffset));
+        const __m256i end = _mm256_set1_epi32(static_cast<int>(limit));
+        const __m256i byteMask = _mm256_set1_epi32(0xFF);
+        const __m256i bitMask = _mm256_set1_epi32(7);
+        const __m256i halfLane = _mm256_set1_epi32(3);
+        const __m256i lastLane = _mm256_set1_epi32(7);
+        __m256i carry = _mm256_set1_epi32(static_cast<int>(running));
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8)
+        {
+            __m256i u = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(usable + i));
+            __m256i sum = _mm256_add_epi32(u, _mm256_slli_si256(u, 4));
+            sum = _mm256_add_epi32(sum, _mm256_slli_si256(sum, 8));
+            sum = _mm256_add_epi32(sum, _mm256_blend_epi32(zero, _mm256_permutevar8x32_epi32(sum, halfLane), 0xF0));
+            sum = _mm256_add_epi32(sum, carry);
+            __m256i slot = _mm256_sub_epi32(sum, u);
+            carry = _mm256_permutevar8x32_epi32(sum, lastLane);
+
+            __m256i pos = _mm256_add_epi32(offset, _mm256_mullo_epi32(slot, width));
+            __m256i inRange = _mm256_and_si256(_mm256_sub_epi32(zero, u), _mm256_cmpgt_epi32(end, pos));
+            __m256i index = _mm256_and_si256(_mm256_srli_epi32(pos, 3), inRange);
+            __m256i bytes = _mm256_i32gather_epi32(reinterpret_cast<const int *>(stream), index, 1);
+            __m256i window = _mm256_or_si256(_mm256_slli_epi32(_mm256_and_si256(bytes, byteMask), 8),
+                                             _mm256_and_si256(_mm256_srli_epi32(bytes, 8), byteMask));
+            __m256i shift = _mm256_sub_epi32(top, _mm256_and_si256(pos, bitMask));
+            __m256i chunk = _mm256_and_si256(_mm256_srlv_epi32(window, shift), low);
+            __m256i mask = _mm256_and_si256(low, inRange);
+            __m256i *w = reinterpret_cast<__m256i *>(words + i);
+            __m256i merged = _mm256_or_si256(_mm256_andnot_si256(mask, _mm256_loadu_si256(w)),
+                                             _mm256_and_si256(chunk, mask));
+            _mm256_storeu_si256(w, merged);
+        }
+        running = static_cast<uint32_t>(_mm256_cvtsi256_si32(carry));
+        return i;
+    }
+#endif
+
+    // Loads one block of samples as host-order words and flags the samples
+    // that may carry data. Both loops are free of data-dependent branches.
+    static void loadBlock(const vector<unsigned char> &file, const FloatRegion &region, size_t first,
+                          size_t n, uint32_t *words, uint32_t *usable)
+    {
+        size_t width = region.sampleBits / 8;
+        const unsigned char *p = file.data() + region.offset + first * width;
+        size_t done = 0;
+#ifdef STEGO_HAVE_X86_SIMD
+        if (ChannelPlanes::level() == ChannelPlanes::LEVEL_AVX2)
+        {
+            done = loadBlockAvx2(p, n, region.sampleBits, region.bigEndian, words, usable);
+        }
+#endif
+        if (region.sampleBits == 32)
+        {
+            for (size_t i = done; i < n; i++)
+            {
+                const unsigned char *s = p + i * 4;
+                words[i] = region.bigEndian
+                               ? (uint32_t(s[0]) << 24) | (uint32_t(s[1]) << 16) | (uint32_t(s[2]) << 8) | s[3]
+                               : (uint32_t(s[3]) << 24) | (uint32_t(s[2]) << 16) | (uint32_t(s[1]) << 8) | s[0];
+            }
+            for (size_t i = done; i < n; i++)
+            {
+                uint32_t exponent = (words[i] >> 23) & 0xFF;
+                usable[i] = (exponent != 0) & (exponent != 0xFF);
+            }
+        }
+        else
+        {
+            for (size_t i = done; i < n; i++)
+            {
+                const unsigned char *s = p + i * 2;
+                words[i] = region.bigEndian ? (uint32_t(s[0]) << 8) | s[1] : (uint32_t(s[1]) << 8) | s[0];
+            }
+            for (size_t i = done; i < n; i++)
+            {
+                uint32_t exponent = (words[i] >> 10) & 0x1F;
+                usable[i] = (exponent != 0) & (exponent != 0x1F);
+            }
+        }
+    }
+
+    static void storeBlock(vector<unsigned char> &file, const FloatRegion &region, size_t first,
+                           size_t n, const uint32_t *words)
+    {
+        size_t width = region.sampleBits / 8;
+        unsigned char *p = file.data() + region.offset + first * width;
+        size_t done = 0;
+#ifdef STEGO_HAVE_X86_SIMD
+        if (ChannelPlanes::level() == ChannelPlanes::LEVEL_AVX2)
+        {
+            done = storeBlockAvx2(p, n, region.sampleBits, region.bigEndian, words);
+        }
+#endif
+        for (size_t i = done; i < n; i++)
+        {
+            for (size_t b = 0; b < width; b++)
+            {
+                size_t shift = region.bigEndian ? 8 * (width - 1 - b) : 8 * b;
+                p[i * width + b] = static_cast<unsigned char>(words[i] >> shift);
+            }
+        }
+    }
+
+    // Writes the stream chunks starting at bitPos into the usable samples of
+    // one block; returns how many samples took a chunk
+    static uint32_t mergeBlock(uint32_t *words, const uint32_t *usable, size_t n, const vector<unsigned char> &padded,
+                               uint64_t bitPos, uint64_t totalBits, int k)
+    {
+        uint32_t running = 0;
+        size_t done = 0;
+#ifdef STEGO_HAVE_X86_SIMD
+        if (ChannelPlanes::level() == ChannelPlanes::LEVEL_AVX2)
+        {
+            uint64_t base = bitPos & ~uint64_t(7);
+            uint32_t limit = static_cast<uint32_t>(min<uint64_t>(totalBits - base, INT32_MAX));
+            done = mergeBlockAvx2(words, usable, n, padded.data() + (base >> 3),
+                                  static_cast<uint32_t>(bitPos & 7), limit, k, running);
+        }
+#endif
+        // Exclusive prefix sum assigns each usable sample its chunk, then a
+        // branch-free merge; a chunk may straddle two stream bytes when
+        // regions with different k follow each other
+        uint32_t low = (1u << k) - 1;
+        uint32_t slot[BLOCK];
+        for (size_t i = done; i < n; i++)
+        {
+            slot[i] = running;
+            running += usable[i];
+        }
+        for (size_t i = done; i < n; i++)
+        {
+            uint64_t pos = bitPos + uint64_t(slot[i]) * k;
+            uint32_t inRange = usable[i] & (pos < totalBits);
+            size_t byteIndex = inRange ? static_cast<size_t>(pos >> 3) : 0;
+            uint32_t window = (uint32_t(padded[byteIndex]) << 8) | padded[byteIndex + 1];
+            uint32_t chunk = (window >> (16 - k - (pos & 7))) & low;
+            uint32_t mask = low & (0u - inRange);
+            words[i] = (words[i] & ~mask) | (chunk & mask);
+        }
+        return running;
+    }
+
+    // The header must end within EXR_HEADER_WINDOW; the line offset table
+    // after it is read on its own
+    static bool parseExr(const FloatLayoutSource &source, vector<FloatRegion> &regions)
+    {
+        vector<unsigned char> d;
+        if (!source.read(0, min(source.size(), Config::EXR_HEADER_WINDOW), d) || d.size() < 8 ||
+            read32(d, 0, false) != Config::EXR_MAGIC)
+        {
+            return false;
+        }
+        uint32_t version = read32(d, 4, false);
+        if ((version & 0xFF) != 2 || (version & (0x200 | 0x800 | 0x1000)) != 0)
+        {
+            return false; // tiled, multi-part and deep images are not supported
+        }
+
+        struct Channel
+        {
+            int type;
+        };
+        vector<Channel> channels;
+        bool haveChannels = false, haveWindow = false;
+        int compression = -1;
+        int32_t xMin = 0, yMin = 0, xMax = -1, yMax = -1;
+
+        size_t pos = 8;
+        while (true)
+        {
+            if (pos >= d.size())
+                return false;
+            if (d[pos] == 0)
+            {
+                pos++;
+                break;
+            }
+
+            size_t nameEnd = find(d.begin() + pos, d.end(), 0) - d.begin();
+            size_t typeEnd = nameEnd < d.size() ? find(d.begin() + nameEnd + 1, d.end(), 0) - d.begin() : d.size();
+            if (typeEnd + 5 > d.size())
+                return false;
+            string name(d.begin() + pos, d.begin() + nameEnd);
+            string type(d.begin() + nameEnd + 1, d.begin() + typeEnd);
+            uint32_t size = read32(d, typeEnd + 1, false);
+            size_t value = typeEnd + 5;
+            if (size > d.size() - value)
+                return false;
+
+            if (name == "channels" && type == "chlist")
+            {
+                size_t c = value;
+                while (c < value + size && d[c] != 0)
+                {
+                    size_t end = find(d.begin() + c, d.begin() + value + size, 0) - d.begin();
+                    if (end + 17 > value + size)
+                        return false;
+                    Channel channel;
+                    channel.type = static_cast<int>(read32(d, end + 1, false));
+                    if (read32(d, end + 9, false) != 1 || read32(d, end + 13, false) != 1)
+                        return false; // subsampled channels
+                    channels.push_back(channel);
+                    c = end + 17;
+                }
+                haveChannels = true;
+            }
+            else if (name == "compression" && size == 1)
+            {
+                compression = d[value];
+            }
+            else if (name == "dataWindow" && size == 16)
+            {
+                xMin = static_cast<int32_t>(read32(d, value, false));
+                yMin = static_cast<int32_t>(read32(d, value + 4, false));
+                xMax = static_cast<int32_t>(read32(d, value + 8, false));
+                yMax = static_cast<int32_t>(read32(d, value + 12, false));
+                haveWindow = true;
+            }
+            pos = value + size;
+        }
+
+        if (!haveChannels || !haveWindow || compression != 0 || xMax < xMin || yMax < yMin)
+        {
+            return false;
+        }
+
+        // Uncompressed files store one scanline per chunk
+        size_t width = static_cast<size_t>(int64_t(xMax) - xMin + 1);
+        size_t lines = static_cast<size_t>(int64_t(yMax) - yMin + 1);
+        vector<unsigned char> table;
+        if (lines > (source.size() - pos) / 8 || !source.read(pos, lines * 8, table))
+            return false;
+
+        for (size_t line = 0; line < lines; line++)
+        {
+            uint64_t offset = uint64_t(read32(table, line * 8, false)) |
+                              (uint64_t(read32(table, line * 8 + 4, false)) << 32);
+            size_t sample = static_cast<size_t>(offset) + 8;
+            for (size_t c = 0; c < channels.size(); c++)
+            {
+                size_t bytes = channels[c].type == 1 ? 2 : 4;
+                if (offset > source.size() || sample + width * bytes > source.size())
+                    return false;
+                if (channels[c].type != 0)
+                {
+                    FloatRegion region = {sample, width, static_cast<unsigned char>(bytes * 8), false};
+                    regions.push_back(region);
+                }
+                sample += width * bytes;
+            }
+        }
+        return true;
+    }
+
+    static bool tiffValues(const FloatLayoutSource &source, const vector<unsigned char> &ifd, size_t entry, bool be,
+                           vector<uint32_t> &values)
+    {
+        uint16_t type = read16(ifd, entry + 2, be);
+        uint32_t count = read32(ifd, entry + 4, be);
+        size_t size = type == 3 ? 2 : (type == 4 ? 4 : 0);
+        if (size == 0 || count > source.size())
+            return false;
+
+        vector<unsigned char> d;
+        if (count * size <= 4)
+            d.assign(ifd.begin() + entry + 8, ifd.begin() + entry + 12);
+        else if (!source.read(read32(ifd, entry + 8, be), count * size, d))
+            return false;
+
+        values.resize(count);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            values[i] = size == 2 ? read16(d, i * 2, be) : read32(d, i * 4, be);
+        }
+        return true;
+    }
+
+    static bool parseTiff(const FloatLayoutSource &source, vector<FloatRegion> &regions)
+    {
+        vector<unsigned char> d;
+        if (!source.read(0, 8, d))
+            return false;
+        bool be;
+        if (d[0] == 'I' && d[1] == 'I' && read16(d, 2, false) == 42)
+            be = false;
+        else if (d[0] == 'M' && d[1] == 'M' && read16(d, 2, true) == 42)
+            be = true;
+        else
+            return false;
+
+        // The IFD without its entry count, so entry i starts at i * 12
+        size_t ifdOffset = read32(d, 4, be);
+        vector<unsigned char> ifd;
+        if (!source.read(ifdOffset, 2, ifd))
+            return false;
+        uint16_t entries = read16(ifd, 0, be);
+        if (!source.read(ifdOffset + 2, entries * 12, ifd))
+            return false;
+
+        vector<uint32_t> bits, format, offsets, counts, compression;
+        for (uint16_t i = 0; i < entries; i++)
+        {
+            size_t entry = i * 12;
+            uint16_t tag = read16(ifd, entry, be);
+            bool ok = true;
+            if (tag == 258)
+                ok = tiffValues(source, ifd, entry, be, bits);
+            else if (tag == 259)
+                ok = tiffValues(source, ifd, entry, be, compression);
+            else if (tag == 273)
+                ok = tiffValues(source, ifd, entry, be, offsets);
+            else if (tag == 279)
+                ok = tiffValues(source, ifd, entry, be, counts);
+            else if (tag == 339)
+                ok = tiffValues(source, ifd, entry, be, format);
+            else if (tag == 322)
+                return false; // tiled
+            if (!ok)
+                return false;
+        }
+
+        if (bits.empty() || format.empty() || offsets.empty() || offsets.size() != counts.size() ||
+            compression.size() != 1 || compression[0] != 1)
+        {
+            return false;
+        }
+        for (size_t i = 0; i < bits.size(); i++)
+        {
+            if (bits[i] != bits[0])
+                return false;
+        }
+        for (size_t i = 0; i < format.size(); i++)
+        {
+            if (format[i] != 3)
+                return false;
+        }
+        if (bits[0] != 16 && bits[0] != 32)
+            return false;
+
+        // Strips that share bytes would carry two parts of the stream
+        size_t bytes = bits[0] / 8;
+        vector<pair<uint32_t, uint32_t> > strips;
+        for (size_t s = 0; s < offsets.size(); s++)
+        {
+            if (offsets[s] > source.size() || counts[s] > source.size() - offsets[s])
+                return false;
+            strips.push_back(make_pair(offsets[s], counts[s]));
+            FloatRegion region = {offsets[s], counts[s] / bytes, static_cast<unsigned char>(bits[0]), be};
+            regions.push_back(region);
+        }
+        sort(strips.begin(), strips.end());
+        for (size_t s = 1; s < strips.size(); s++)
+        {
+            if (strips[s].first == strips[s - 1].first ||
+                strips[s].first - strips[s - 1].first < strips[s - 1].second)
+                return false;
+        }
+        return true;
+    }
+
+    static bool parse(const FloatLayoutSource &source, vector<FloatRegion> &regions)
+    {
+        regions.clear();
+        if (parseExr(source, regions) || parseTiff(source, regions))
+        {
+            return true;
+        }
+        regions.clear();
+        return false;
+    }
+
+public:
+    static bool parse(const vector<unsigned char> &file, vector<FloatRegion> &regions)
+    {
+        return parse(FloatLayoutSource(file), regions);
+    }
+
+    // Reads only the header and offset tables, not the samples
+    static bool isSupported(const string &filename)
+    {
+        PageFile file(filename, false);
+        vector<FloatRegion> regions;
+        return parse(FloatLayoutSource(file, Utils::getFileSize(filename)), regions);
+    }
+
+    static size_t capacity(const vector<unsigned char> &file, const vector<FloatRegion> &regions)
+    {
+        uint64_t bits = 0;
+        uint32_t words[BLOCK], usable[BLOCK];
+        for (size_t r = 0; r < regions.size(); r++)
+        {
+            for (size_t first = 0; first < regions[r].count; first += BLOCK)
+            {
+                size_t n = min(BLOCK, regions[r].count - first);
+                loadBlock(file, regions[r], first, n, words, usable);
+                uint32_t count = 0;
+                for (size_t i = 0; i < n; i++)
+                    count += usable[i];
+                bits += uint64_t(count) * embedBits(regions[r]);
+            }
+        }
+        return static_cast<size_t>(bits / 8);
+    }
+
+    static void embed(vector<unsigned char> &file, const vector<FloatRegion> &regions,
+                      const vector<unsigned char> &stream)
+    {
+        if (stream.size() > capacity(file, regions))
+        {
+            throw FileSizeException("Hidden data exceeds the float image capacity");
+        }
+
+        // Zero padding lets every chunk read a four-byte window (the AVX2
+        // gather loads whole words; the scalar merge reads two bytes)
+        vector<unsigned char> padded(stream);
+        padded.resize(stream.size() + 3, 0);
+
+        uint64_t totalBits = uint64_t(stream.size()) * 8;
+        uint64_t bitPos = 0;
+        uint32_t words[BLOCK], usable[BLOCK];
+        for (size_t r = 0; r < regions.size() && bitPos < totalBits; r++)
+        {
+            int k = embedBits(regions[r]);
+            for (size_t first = 0; first < regions[r].count && bitPos < totalBits; first += BLOCK)
+            {
+                size_t n = min(BLOCK, regions[r].count - first);
+                loadBlock(file, regions[r], first, n, words, usable);
+                uint32_t running = mergeBlock(words, usable, n, padded, bitPos, totalBits, k);
+                storeBlock(file, regions[r], first, n, words);
+                bitPos += uint64_t(running) * k;
+                STEGO_PROBE3(chunk_done, "float_block", n, true);
+            }
+        }
+    }
+
+    static bool extract(const vector<unsigned char> &file, const vector<FloatRegion> &regions,
+                        vector<unsigned char> &stream, const char *expectedName = NULL)
+    {
+        StegoStreamCollector collector(stream, expectedName);
+        uint32_t words[BLOCK], usable[BLOCK];
+        unsigned int bits = 0;
+        int bitCount = 0;
+        for (size_t r = 0; r < regions.size(); r++)
+        {
+            int k = embedBits(regions[r]);
+            uint32_t low = (1u << k) - 1;
+            for (size_t first = 0; first < regions[r].count; first += BLOCK)
+            {
+                size_t n = min(BLOCK, regions[r].count - first);
+                loadBlock(file, regions[r], first, n, words, usable);
+                for (size_t i = 0; i < n; i++)
+                {
+                    if (!usable[i])
+                        continue;
+                    bits = (bits << k) | (words[i] & low);
+                    bitCount += k;
+                    if (bitCount >= 8)
+                    {
+                        bitCount -= 8;
+                        if (!collector.add(static_cast<unsigned char>(bits >> bitCount)))
+                            return collector.found();
+                        bits &= (1u << bitCount) - 1;
+                    }
+                }
+            }
+        }
+        return collector.found();
+    }
+};
+
+// min() binds BLOCK by reference, so unoptimized builds need a definition
+const size_t FloatImageEngine::BLOCK;
+
+// ============================================================================
+// DICOM HOST ENGINE
+// ============================================================================
+// Hides the stego stream in the lowest stored bit of native 16-bit Pixel Data
+// samples. The tag structure is walked with seeks and never loaded, and the
+// output starts as a clone of the cover, so only the pixel bytes that carry
+// data are rewritten. Bits outside Bits Stored / High Bit are never changed.
+// Each frame carries its own slice of the stream, starting at its first
+// sample, so capacity is counted in whole frames.
+struct DicomPixelInfo
+{
+    uint64_t pixelOffset;
+    uint64_t pixelLength;
+    uint32_t frames;
+    uint16_t rows;
+    uint16_t columns;
+    uint16_t samplesPerPixel;
+    uint16_t bitsAllocated;
+    uint16_t bitsStored;
+    uint16_t highBit;
+
+    uint64_t frameSamples() const
+    {
+        return uint64_t(rows) * columns * samplesPerPixel;
+    }
+
+    // Stream bytes one frame can carry (1 bit per sample)
+    size_t frameCapacity() const
+    {
+        return static_cast<size_t>(frameSamples() / 8);
+    }
+
+    int embedBit() const
+    {
+        return highBit + 1 - bitsStored;
+    }
+};
+
+class DicomEngine
+{
+private:
+    static const uint32_t UNDEFINED_LENGTH = 0xFFFFFFFF;
+    static const uint32_t TAG_TRANSFER_SYNTAX = 0x00020010;
+    static const uint32_t TAG_SAMPLES_PER_PIXEL = 0x00280002;
+    static const uint32_t TAG_NUMBER_OF_FRAMES = 0x00280008;
+    static const uint32_t TAG_ROWS = 0x00280010;
+    static const uint32_t TAG_COLUMNS = 0x00280011;
+    static const uint32_t TAG_BITS_ALLOCATED = 0x00280100;
+    static const uint32_t TAG_BITS_STORED = 0x00280101;
+    static const uint32_t TAG_HIGH_BIT = 0x00280102;
+    static const uint32_t TAG_PIXEL_DATA = 0x7FE00010;
+    static const uint32_t TAG_ITEM = 0xFFFEE000;
+    static const uint32_t TAG_ITEM_DELIMITER = 0xFFFEE00D;
+    static const uint32_t TAG_SEQUENCE_DELIMITER = 0xFFFEE0DD;
+    static const int MAX_SEQUENCE_DEPTH = 32;
+
+    static bool readBytes(istream &in, unsigned char *buffer, size_t length)
+    {
+        in.read(reinterpret_cast<char *>(buffer), length);
+        return in.gcount() == static_cast<streamsize>(length);
+    }
+
+    static uint32_t le32(const unsigned char *p)
+    {
+        return (uint32_t(p[3]) << 24) | (uint32_t(p[2]) << 16) | (uint32_t(p[1]) << 8) | p[0];
+    }
+
+    // VRs whose explicit encoding has 2 reserved bytes and a 32-bit length
+    static bool hasLongLength(const char *vr)
+    {
+        static const char *const kinds[] = {"OB", "OD", "OF", "OL", "OV", "OW", "SQ",
+                                            "SV", "UC", "UN", "UR", "UT", "UV"};
+        for (size_t i = 0; i < sizeof(kinds) / sizeof(kinds[0]); i++)
+        {
+            if (vr[0] == kinds[i][0] && vr[1] == kinds[i][1])
+                return true;
+        }
+        return false;
+    }
+
+    // Items and delimiters always use the implicit layout: tag + 32-bit length
+    static bool readElement(istream &in, bool explicitVR, uint32_t &tag, uint32_t &length, char *vr)
+    {
+        unsigned char h[8];
+        if (!readBytes(in, h, sizeof(h)))
+        {
+            return false;
+        }
+        uint16_t group = static_cast<uint16_t>(h[0] | (h[1] << 8));
+        uint16_t element = static_cast<uint16_t>(h[2] | (h[3] << 8));
+        tag = (uint32_t(group) << 16) | element;
+        vr[0] = vr[1] = ' ';
+        if (!explicitVR || group == 0xFFFE)
+        {
+            length = le32(h + 4);
+            return true;
+        }
+
+        vr[0] = static_cast<char>(h[4]);
+        vr[1] = static_cast<char>(h[5]);
+        if (!hasLongLength(vr))
+        {
+            length = static_cast<uint32_t>(h[6] | (h[7] << 8));
+            return true;
+        }
+        unsigned char l[4];
+        if (!readBytes(in, l, sizeof(l)))
+        {
+            return false;
+        }
+        length = le32(l);
+        return true;
+    }
+
+    // Skips an undefined-length sequence (or encapsulated value) up to and
+    // including its delimiter
+    static bool skipSequence(istream &in, bool explicitVR, int depth)
+    {
+        if (depth > MAX_SEQUENCE_DEPTH)
+        {
+            return false;
+        }
+        uint32_t tag, length;
+        char vr[2];
+        while (readElement(in, explicitVR, tag, length, vr))
+        {
+            if (tag == TAG_SEQUENCE_DELIMITER)
+            {
+                return true;
+            }
+            if (tag == TAG_ITEM_DELIMITER || (tag == TAG_ITEM && length == UNDEFINED_LENGTH))
+            {
+                continue;
+            }
+            if (length == UNDEFINED_LENGTH)
+            {
+                // UN with undefined length holds an implicit VR sequence
+                bool nestedExplicit = explicitVR && !(vr[0] == 'U' && vr[1] == 'N');
+                if (!skipSequence(in, nestedExplicit, depth + 1))
+                    return false;
+                continue;
+            }
+            in.seekg(length, ios::cur);
+        }
+        return false;
+    }
+
+    static string readString(istream &in, uint32_t length)
+    {
+        string value(length, '\0');
+        if (length > 0 && !readBytes(in, reinterpret_cast<unsigned char *>(&value[0]), length))
+        {
+            return string();
+        }
+        while (!value.empty() && (value.back() == '\0' || value.back() == ' '))
+        {
+            value.pop_back();
+        }
+        return value;
+    }
+
+    static bool readUnsigned16(istream &in, uint32_t length, uint16_t &value)
+    {
+        unsigned char v[2];
+        if (length != 2 || !readBytes(in, v, 2))
+        {
+            return false;
+        }
+        value = static_cast<uint16_t>(v[0] | (v[1] << 8));
+        return true;
+    }
+
+    static bool parse(istream &in, uint64_t fileSize, DicomPixelInfo &info)
+    {
+        unsigned char magic[4];
+        in.seekg(Config::DICOM_PREAMBLE_SIZE);
+        if (!readBytes(in, magic, sizeof(magic)) || memcmp(magic, "DICM", 4) != 0)
+        {
+            return false;
+        }
+
+        // The file meta group is always explicit VR little endian
+        string transferSyntax;
+        uint32_t tag, length;
+        char vr[2];
+        streampos datasetStart = in.tellg();
+        while (readElement(in, true, tag, length, vr) && (tag >> 16) == 0x0002)
+        {
+            if (length == UNDEFINED_LENGTH)
+            {
+                return false;
+            }
+            if (tag == TAG_TRANSFER_SYNTAX)
+                transferSyntax = readString(in, length);
+            else
+                in.seekg(length, ios::cur);
+            datasetStart = in.tellg();
+        }
+        in.clear();
+        in.seekg(datasetStart);
+
+        // Compressed, deflated and big endian syntaxes keep their pixels opaque
+        bool explicitVR;
+        if (transferSyntax == "1.2.840.10008.1.2.1")
+            explicitVR = true;
+        else if (transferSyntax == "1.2.840.10008.1.2")
+            explicitVR = false;
+        else
+            return false;
+
+        memset(&info, 0, sizeof(info));
+        info.frames = 1;
+        info.samplesPerPixel = 1;
+        bool ok = true;
+        while (ok && readElement(in, explicitVR, tag, length, vr))
+        {
+            if (tag == TAG_PIXEL_DATA)
+            {
+                if (length == UNDEFINED_LENGTH)
+                {
+                    return false; // encapsulated frames
+                }
+                info.pixelOffset = static_cast<uint64_t>(in.tellg());
+                info.pixelLength = length;
+                break;
+            }
+            if (length == UNDEFINED_LENGTH)
+            {
+                bool nestedExplicit = explicitVR && !(vr[0] == 'U' && vr[1] == 'N');
+                ok = skipSequence(in, nestedExplicit, 1);
+                continue;
+            }
+
+            switch (tag)
+            {
+            case TAG_SAMPLES_PER_PIXEL:
+                ok = readUnsigned16(in, length, info.samplesPerPixel);
+                break;
+            case TAG_ROWS:
+                ok = readUnsigned16(in, length, info.rows);
+                break;
+            case TAG_COLUMNS:
+                ok = readUnsigned16(in, length, info.columns);
+                break;
+            case TAG_BITS_ALLOCATED:
+                ok = readUnsigned16(in, length, info.bitsAllocated);
+                break;
+            case TAG_BITS_STORED:
+                ok = readUnsigned16(in, length, info.bitsStored);
+                break;
+            case TAG_HIGH_BIT:
+                ok = readUnsigned16(in, length, info.highBit);
+                break;
+            case TAG_NUMBER_OF_FRAMES:
+                info.frames = static_cast<uint32_t>(strtoul(readString(in, length).c_str(), NULL, 10));
+                break;
+            default:
+                in.seekg(length, ios::cur);
+                break;
+            }
+        }
+
+        return ok && info.pixelLength > 0 && info.bitsAllocated == 16 &&
+               info.bitsStored >= 1 && info.bitsStored <= 16 &&
+               info.highBit < 16 && info.highBit + 1 >= info.bitsStored &&
+               info.frames > 0 && info.frameSamples() > 0 &&
+               info.frameSamples() * 2 * info.frames <= info.pixelLength &&
+               info.pixelOffset + info.pixelLength <= fileSize;
+    }
+
+    static DicomPixelInfo open(istream &in, const string &filename)
+    {
+        DicomPixelInfo info;
+        if (!parse(in, Utils::getFileSize(filename), info))
+        {
+            throw InvalidFormatException("Unsupported DICOM pixel data: " + filename);
+        }
+        return info;
+    }
+
+    // Stream bytes per buffer; every stream byte spans 8 samples (16 bytes)
+    static size_t chunkBytes()
+    {
+        return Config::DICOM_IO_BUFFER_SIZE / 16;
+    }
+
+    static uint64_t frameOffset(const DicomPixelInfo &info, uint32_t frame)
+    {
+        return info.pixelOffset + uint64_t(frame) * info.frameSamples() * 2;
+    }
+
+public:
+    // Native 16-bit pixel data in an explicit or implicit VR little endian file
+    static bool isSupported(const string &filename)
+    {
+        ifstream in(filename, ios::binary);
+        DicomPixelInfo info;
+        return in.is_open() && parse(in, Utils::getFileSize(filename), info);
+    }
+
+    static DicomPixelInfo readInfo(const string &filename)
+    {
+        ifstream in(filename, ios::binary);
+        if (!in.is_open())
+        {
+            throw FileAccessException("Cannot open file for reading: " + filename);
+        }
+        return open(in, filename);
+    }
+
+    static size_t capacity(const DicomPixelInfo &info)
+    {
+        return info.frameCapacity() * info.frames;
+    }
+
+    static uint64_t framesNeeded(const DicomPixelInfo &info, size_t streamSize)
+    {
+        size_t perFrame = info.frameCapacity();
+        return perFrame == 0 ? UINT64_MAX : (streamSize + perFrame - 1) / perFrame;
+    }
+
+    // Patches the stream into an existing copy of the cover in place
+    static void embed(const string &outputPath, const vector<unsigned char> &stream)
+    {
+        fstream file(outputPath, ios::in | ios::out | ios::binary);
+        if (!file.is_open())
+        {
+            throw FileAccessException("Cannot open file for writing: " + outputPath);
+        }
+        DicomPixelInfo info = open(file, outputPath);
+        uint64_t needed = framesNeeded(info, stream.size());
+        if (needed > info.frames)
+        {
+            throw FileSizeException(
+                "Hidden data exceeds the DICOM pixel capacity.\n" +
+                string("  Frame capacity: ") + Utils::formatBytes(info.frameCapacity()) + "\n" +
+                string("  Frames needed: ") + to_string(needed) + "\n" +
+                string("  Frames available: ") + to_string(info.frames));
+        }
+
+        int bit = info.embedBit();
+        int shift = bit & 7;
+        vector<unsigned char> buffer(Config::DICOM_IO_BUFFER_SIZE);
+        vector<unsigned char> low(Config::DICOM_TILE_SAMPLES);
+        vector<unsigned char> high(Config::DICOM_TILE_SAMPLES);
+        unsigned char *carrier = bit < 8 ? low.data() : high.data();
+        size_t done = 0;
+        for (uint32_t frame = 0; done < stream.size(); frame++)
+        {
+            size_t frameBytes = min(info.frameCapacity(), stream.size() - done);
+            for (size_t first = 0; first < frameBytes; first += chunkBytes())
+            {
+                size_t n = min(chunkBytes(), frameBytes - first);
+                streamoff offset = static_cast<streamoff>(frameOffset(info, frame) + uint64_t(first) * 16);
+                file.seekg(offset);
+                if (!readBytes(file, buffer.data(), n * 16))
+                {
+                    throw FileAccessException("Error reading file: " + outputPath);
+                }
+
+                // Cache-sized tiles: split into byte planes, set the
+                // carrier bits, merge back
+                for (size_t i = 0; i < n; i += Config::DICOM_TILE_SAMPLES / 8)
+                {
+                    size_t bytes = min(Config::DICOM_TILE_SAMPLES / 8, n - i);
+                    unsigned char *samples = buffer.data() + i * 16;
+                    ChannelPlanes::split16(samples, bytes * 8, low.data(), high.data());
+                    ChannelPlanes::scatterBits(stream.data() + done + first + i, bytes, shift, carrier);
+                    ChannelPlanes::merge16(low.data(), high.data(), bytes * 8, samples);
+                }
+
+                file.seekp(offset);
+                file.write(reinterpret_cast<const char *>(buffer.data()), n * 16);
+                STEGO_PROBE3(chunk_done, "dicom_chunk", n * 8, file.good());
+            }
+            done += frameBytes;
+        }
+
+        file.flush();
+        if (!file)
+        {
+            throw FileAccessException("Error writing to file: " + outputPath);
+        }
+    }
+
+    // Reads frame slices until the collector has the whole stream
+    static bool extract(const string &filename, vector<unsigned char> &stream, const char *expectedName = NULL)
+    {
+        ifstream in(filename, ios::binary);
+        if (!in.is_open())
+        {
+            throw FileAccessException("Cannot open file for reading: " + filename);
+        }
+        DicomPixelInfo info = open(in, filename);
+
+        int bit = info.embedBit();
+        int shift = bit & 7;
+        StegoStreamCollector collector(stream, expectedName);
+        vector<unsigned char> buffer(Config::DICOM_IO_BUFFER_SIZE);
+        vector<unsigned char> low(Config::DICOM_TILE_SAMPLES);
+        vector<unsigned char> high(Config::DICOM_TILE_SAMPLES);
+        vector<unsigned char> bytes(Config::DICOM_TILE_SAMPLES / 8);
+        const unsigned char *carrier = bit < 8 ? low.data() : high.data();
+        bool more = true;
+        for (uint32_t frame = 0; more && frame < info.frames; frame++)
+        {
+            size_t frameBytes = info.frameCapacity();
+            for (size_t first = 0; more && first < frameBytes; first += chunkBytes())
+            {
+                size_t n = min(chunkBytes(), frameBytes - first);
+                in.seekg(static_cast<streamoff>(frameOffset(info, frame) + uint64_t(first) * 16));
+                if (!readBytes(in, buffer.data(), n * 16))
+                {
+                    return collector.found();
+                }
+
+                for (size_t i = 0; i < n && more; i += bytes.size())
+                {
+                    size_t count = min(bytes.size(), n - i);
+                    ChannelPlanes::split16(buffer.data() + i * 16, count * 8, low.data(), high.data());
+                    ChannelPlanes::gatherBits(carrier, count, shift, bytes.data());
+                    for (size_t j = 0; j < count && more; j++)
+                    {
+                        more = collector.add(bytes[j]);
+                    }
+                }
+            }
+        }
+        return collector.found();
+    }
+};
+
+// ============================================================================
+// SQLITE FREELIST HOST ENGINE
+// ============================================================================
+// Hides the stego stream in the freelist leaf pages of a SQLite database.
+// SQLite never reads a leaf page's content until it reuses the page, so
+// the database stays valid (integrity_check passes). Only the trunk pages
+// and the pages that carry data are read or written, each with one
+// positional I/O call. Writing to the database later may reuse free pages
+// and overwrite the hidden data.
+struct SqliteFreelist
+{
+    uint32_t pageSize;
+    uint32_t usableSize;
+    uint32_t pageCount;
+    uint32_t freePages;
+    vector<uint32_t> leafPages; // page map: the stream fills these in order
+
+    uint64_t pageOffset(uint32_t page) const
+    {
+        return uint64_t(page - 1) * pageSize;
+    }
+};
+
+class SqliteEngine
+{
+private:
+    static const size_t HEADER_SIZE = 100;
+
+    static uint32_t be32(const unsigned char *p)
+    {
+        return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | p[3];
+    }
+
+    static bool parse(PageFile &file, uint64_t fileSize, SqliteFreelist &list)
+    {
+        unsigned char h[HEADER_SIZE];
+        if (!file.readAt(0, h, sizeof(h)) || memcmp(h, "SQLite format 3\0", 16) != 0)
+        {
+            return false;
+        }
+
+        uint32_t pageSize = (uint32_t(h[16]) << 8) | h[17];
+        if (pageSize == 1)
+        {
+            pageSize = 65536;
+        }
+        if (pageSize < 512 || pageSize > 65536 || (pageSize & (pageSize - 1)) != 0 || h[18] > 2 || h[19] > 2)
+        {
+            return false;
+        }
+
+        list.pageSize = pageSize;
+        list.usableSize = pageSize - h[20]; // reserved bytes belong to checksum/codec extensions
+        list.pageCount = be32(h + 28);
+        if (list.pageCount == 0 || be32(h + 24) != be32(h + 92))
+        {
+            list.pageCount = static_cast<uint32_t>(fileSize / pageSize); // header page count is stale
+        }
+        if (list.usableSize < 480 || uint64_t(list.pageCount) * pageSize > fileSize)
+        {
+            return false;
+        }
+
+        list.freePages = be32(h + 36);
+        list.leafPages.clear();
+        uint32_t trunk = be32(h + 32);
+        uint32_t trunks = 0;
+        uint32_t maxLeaves = list.usableSize / 4 - 2;
+        vector<unsigned char> page(list.usableSize);
+        while (trunk != 0)
+        {
+            // A cycle or a page outside the file means a corrupt freelist
+            if (trunk < 2 || trunk > list.pageCount || ++trunks > list.freePages ||
+                !file.readAt(list.pageOffset(trunk), page.data(), page.size()))
+            {
+                return false;
+            }
+
+            uint32_t count = be32(page.data() + 4);
+            if (count > maxLeaves)
+            {
+                return false;
+            }
+            for (uint32_t i = 0; i < count; i++)
+            {
+                uint32_t leaf = be32(page.data() + 8 + 4 * i);
+                if (leaf < 2 || leaf > list.pageCount)
+                {
+                    return false;
+                }
+                list.leafPages.push_back(leaf);
+            }
+            trunk = be32(page.data());
+        }
+        return uint64_t(trunks) + list.leafPages.size() == list.freePages;
+    }
+
+    static SqliteFreelist open(PageFile &file, const string &filename)
+    {
+        SqliteFreelist list;
+        if (!parse(file, Utils::getFileSize(filename), list))
+        {
+            throw InvalidFormatException("Unsupported or corrupt SQLite database: " + filename);
+        }
+        return list;
+    }
+
+public:
+    // A rollback-journal database, or a WAL database with no pending WAL file
+    // (free pages listed in the main file may be stale until a checkpoint)
+    static bool isSupported(const string &filename)
+    {
+        if (Utils::fileExists(filename + "-wal") || Utils::fileExists(filename + "-journal"))
+        {
+            return false;
+        }
+        PageFile file(filename, false);
+        SqliteFreelist list;
+        return parse(file, Utils::getFileSize(filename), list);
+    }
+
+    static SqliteFreelist readFreelist(const string &filename)
+    {
+        PageFile file(filename, false);
+        return open(file, filename);
+    }
+
+    static size_t capacity(const SqliteFreelist &list)
+    {
+        return list.leafPages.size() * list.usableSize;
+    }
+
+    static size_t pagesNeeded(const SqliteFreelist &list, size_t streamSize)
+    {
+        return (streamSize + list.usableSize - 1) / list.usableSize;
+    }
+
+    // Writes the stream into the leaf pages of an existing copy of the cover
+    static void embed(const string &outputPath, const vector<unsigned char> &stream)
+    {
+        PageFile file(outputPath, true);
+        SqliteFreelist list = open(file, outputPath);
+        if (stream.size() > capacity(list))
+        {
+            throw FileSizeException("Hidden data exceeds the free pages of the database");
+        }
+
+        for (size_t i = 0, done = 0; done < stream.size(); i++)
+        {
+            size_t n = min(static_cast<size_t>(list.usableSize), stream.size() - done);
+            file.writeAt(list.pageOffset(list.leafPages[i]), stream.data() + done, n);
+            done += n;
+            STEGO_PROBE3(chunk_done, "sqlite_page", n, true);
+        }
+    }
+
+    // Follows the page map until the collector has the whole stream
+    static bool extract(const string &filename, vector<unsigned char> &stream, const char *expectedName = NULL)
+    {
+        PageFile file(filename, false);
+        SqliteFreelist list = open(file, filename);
+        StegoStreamCollector collector(stream, expectedName);
+        vector<unsigned char> page(list.usableSize);
+        bool more = true;
+        for (size_t i = 0; more && i < list.leafPages.size(); i++)
+        {
+            if (!file.readAt(list.pageOffset(list.leafPages[i]), page.data(), page.size()))
+            {
+                break;
+            }
+            for (size_t j = 0; j < page.size() && more; j++)
+            {
+                more = collector.add(page[j]);
+            }
+        }
+        return collector.found();
+    }
+};
+
+// ============================================================================
+// HOST FORMAT DETECTION
+// ============================================================================
+enum HostFormat
+{
+    HOST_APPEND,
+    HOST_QOI,
+    HOST_FLOAT_IMAGE,
+    HOST_DICOM,
+    HOST_SQLITE,
+    HOST_FORMAT_COUNT
+};
+
+class HostDetector
+{
+public:
+    // Leading bytes needed to recognise every engine format
+    static const size_t MAGIC_SIZE = Config::DICOM_PREAMBLE_SIZE + 4;
+
+    // True when the leading bytes may belong to an engine format; callers that
+    // only handle appended covers must go through detect() for those
+    static bool hasEngineMagic(const unsigned char *magic, size_t length)
+    {
+        if (length < 4)
+        {
+            return false;
+        }
+        return memcmp(magic, "qoif", 4) == 0 ||
+               (length >= 16 && memcmp(magic, "SQLite format 3\0", 16) == 0) ||
+               (length >= MAGIC_SIZE && memcmp(magic + Config::DICOM_PREAMBLE_SIZE, "DICM", 4) == 0) ||
+               (magic[0] == 0x76 && magic[1] == 0x2f && magic[2] == 0x31 && magic[3] == 0x01) ||
+               memcmp(magic, "II*\0", 4) == 0 || memcmp(magic, "MM\0*", 4) == 0;
+    }
+
+    static HostFormat detect(const string &filename)
+    {
+        unsigned char magic[MAGIC_SIZE] = {0};
+        ifstream file(filename, ios::binary);
+        file.read(reinterpret_cast<char *>(magic), sizeof(magic));
+        if (file.gcount() < 4)
+        {
+            return HOST_APPEND;
+        }
+        if (memcmp(magic, "qoif", 4) == 0)
+        {
+            return HOST_QOI;
+        }
+        if (file.gcount() >= 16 && memcmp(magic, "SQLite format 3\0", 16) == 0 && SqliteEngine::isSupported(filename))
+        {
+            return HOST_SQLITE;
+        }
+
+        // Checked before TIFF: a DICOM preamble may itself be a TIFF header
+        if (file.gcount() == static_cast<streamsize>(sizeof(magic)) &&
+            memcmp(magic + Config::DICOM_PREAMBLE_SIZE, "DICM", 4) == 0 && DicomEngine::isSupported(filename))
+        {
+            return HOST_DICOM;
+        }
+
+        // EXR and TIFF are only taken when they hold uncompressed float samples
+        bool exr = magic[0] == 0x76 && magic[1] == 0x2f && magic[2] == 0x31 && magic[3] == 0x01;
+        bool tiff = memcmp(magic, "II*\0", 4) == 0 || memcmp(magic, "MM\0*", 4) == 0;
+        if ((exr || tiff) && FloatImageEngine::isSupported(filename))
+        {
+            return HOST_FLOAT_IMAGE;
+        }
+        return HOST_APPEND;
+    }
+
+    static const char *name(HostFormat format)
+    {
+        switch (format)
+        {
+        case HOST_QOI:
+            return "QOI pixel LSB";
+        case HOST_FLOAT_IMAGE:
+            return "float mantissa (EXR/TIFF)";
+        case HOST_DICOM:
+            return "DICOM pixel LSB";
+        case HOST_SQLITE:
+            return "SQLite free pages";
+        default:
+            return "appended";
+        }
+    }
+
+    // Short name used in cost model files
+    static const char *key(HostFormat format)
+    {
+        static const char *const keys[HOST_FORMAT_COUNT] = {"append", "qoi", "float", "dicom", "sqlite"};
+        return keys[format];
+    }
+};
+
+// ============================================================================
+// COST MODEL
+// ============================================================================
+// Estimated encode time per host format, used to fit jobs to a deadline:
+//   fixedUs + nsPerCoverByte * cover bytes + nsPerStreamByte * stream bytes
+// The built-in figures are rough; `stego bench --calibrate <file>` measures
+// them on the local machine and `--cost-model <file>` loads the result.
+struct CostCoefficients
+{
+    double fixedUs;
+    double nsPerCoverByte;
+    double nsPerStreamByte;
+};
+
+class CostModel
+{
+private:
+    CostCoefficients coefficients[HOST_FORMAT_COUNT];
+
+    CostModel()
+    {
+        const CostCoefficients defaults[HOST_FORMAT_COUNT] = {
+            {60.0, 0.8, 15.0},   // append
+            {200.0, 8.0, 100.0}, // QOI
+            {350.0, 3.0, 35.0},  // float
+            {220.0, 1.6, 90.0},  // DICOM
+            {230.0, 1.2, 2.0}};  // SQLite
+        memcpy(coefficients, defaults, sizeof(coefficients));
+    }
+
+public:
+    static CostModel &instance()
+    {
+        static CostModel model;
+        return model;
+    }
+
+    double estimateUs(HostFormat format, uint64_t coverBytes, uint64_t streamBytes) const
+    {
+        const CostCoefficients &c = coefficients[format];
+        return c.fixedUs + (c.nsPerCoverByte * coverBytes + c.nsPerStreamByte * streamBytes) / 1000.0;
+    }
+
+    const CostCoefficients &get(HostFormat format) const
+    {
+        return coefficients[format];
+    }
+
+    void set(HostFormat format, const CostCoefficients &values)
+    {
+        coefficients[format] = values;
+    }
+
+    // One line per format: "<key> <fixed_us> <ns_per_cover_byte> <ns_per_stream_byte>"
+    void load(const string &filename)
+    {
+        ifstream in(filename);
+        if (!in.is_open())
+        {
+            throw FileAccessException("Cannot open file for reading: " + filename);
+        }
+        string line;
+        while (getline(in, line))
+        {
+            if (line.empty() || line[0] == '#')
+            {
+                continue;
+            }
+            istringstream fields(line);
+            string key;
+            CostCoefficients values;
+            if (!(fields >> key >> values.fixedUs >> values.nsPerCoverByte >> values.nsPerStreamByte))
+            {
+                throw InvalidFormatException("Invalid cost model line: " + line);
+            }
+            for (int f = 0; f < HOST_FORMAT_COUNT; f++)
+            {
+                if (key == HostDetector::key(static_cast<HostFormat>(f)))
+                {
+                    coefficients[f] = values;
+                }
+            }
+        }
+    }
+
+    void save(const string &filename) const
+    {
+        ofstream out(filename);
+        if (!out.is_open())
+        {
+            throw FileAccessException("Cannot create output file: " + filename);
+        }
+        out << "# format fixed_us ns_per_cover_byte ns_per_stream_byte" << endl;
+        for (int f = 0; f < HOST_FORMAT_COUNT; f++)
+        {
+            const CostCoefficients &c = coefficients[f];
+            out << HostDetector::key(static_cast<HostFormat>(f)) << " " << fixed << setprecision(3)
+                << c.fixedUs << " " << c.nsPerCoverByte << " " << c.nsPerStreamByte << endl;
+        }
+        if (!out)
+        {
+            throw FileAccessException("Error writing to file: " + filename);
+        }
+    }
+};
+
+// ============================================================================
+// PAYLOAD LOCATOR CLASS
+// ============================================================================
+class PayloadLocator
+{
+public:
+    // Searches backwards from the end of the file for a valid header
+    static bool findHeader(const vector<unsigned char> &data, size_t &headerOffset, StegoHeader &header)
+    {
+        if (data.size() < sizeof(StegoHeader))
+        {
+            return false;
+        }
+
+        for (size_t i = data.size() - sizeof(StegoHeader); i > 0; i--)
+        {
+            uint32_t magic;
+            memcpy(&magic, data.data() + i, sizeof(magic));
+            if (magic == Config::MAGIC_SIGNATURE)
+            {
+                memcpy(&header, data.data() + i, sizeof(StegoHeader));
+                bool valid = header.validate();
+                STEGO_PROBE2(header_candidate, i, valid);
+                if (valid)
+                {
+                    headerOffset = i;
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    // Reads the stego stream of an engine format; false for appended covers
+    static bool extractStream(const string &filename, HostFormat format, vector<unsigned char> &stream,
+                              const char *expectedName = NULL)
+    {
+        if (format == HOST_QOI)
+        {
+            return QoiEngine::extract(filename, stream, expectedName);
+        }
+        if (format == HOST_FLOAT_IMAGE)
+        {
+            vector<FloatRegion> regions;
+            vector<unsigned char> file = FileIOManager::readFile(filename);
+            FloatImageEngine::parse(file, regions);
+            return FloatImageEngine::extract(file, regions, stream, expectedName);
+        }
+        if (format == HOST_DICOM)
+        {
+            return DicomEngine::extract(filename, stream, expectedName);
+        }
+        if (format == HOST_SQLITE)
+        {
+            return SqliteEngine::extract(filename, stream, expectedName);
+        }
+        return false;
+    }
+
+    // Loads the bytes that carry the stego header: the decoded LSB stream for
+    // pixel engines (header at offset 0), otherwise the raw file.
+    static bool locate(const string &filename, vector<unsigned char> &data, size_t &headerOffset, StegoHeader &header)
+    {
+        vector<unsigned char> stream;
+        if (extractStream(filename, HostDetector::detect(filename), stream))
+        {
+            data.swap(stream);
+            headerOffset = 0;
+            memcpy(&header, data.data(), sizeof(StegoHeader));
+            return true;
+        }
+
+        data = FileIOManager::readFile(filename);
+        return findHeader(data, headerOffset, header);
+    }
+
+    static vector<ExtensionRecord> readExtensions(const vector<unsigned char> &data,
+                                                  size_t headerOffset, const StegoHeader &header)
+    {
+        size_t extensionOffset = headerOffset + sizeof(StegoHeader) + header.hiddenFileSize;
+        if (extensionOffset > data.size())
+        {
+            throw InvalidFormatException("Corrupted file: size mismatch");
+        }
+        return HeaderExtensions::parse(data.data() + extensionOffset, data.size() - extensionOffset);
+    }
+};
+
+// ============================================================================
+// PAYLOAD DIGEST CLASS
+// ============================================================================
+// Every new stream carries the SHA-256 of its payload as an extension record,
+// so partners can match documents by the digest they already use.
+class PayloadDigest
+{
+public:
+    static size_t recordSize()
+    {
+        return 4 + Sha256::DIGEST_SIZE;
+    }
+
+    static const size_t EXTENSION_BLOCK_SIZE = sizeof(ExtensionBlockHeader) + 4 + Sha256::DIGEST_SIZE;
+
+    static ExtensionRecord record(const unsigned char *digest)
+    {
+        return ExtensionRecord(Config::EXT_SHA256, vector<unsigned char>(digest, digest + Sha256::DIGEST_SIZE));
+    }
+
+    // The whole extension block for an unsigned stream, without the heap
+    static size_t writeBlock(const unsigned char *digest, unsigned char *out)
+    {
+        return HeaderExtensions::serializeRecord(Config::EXT_SHA256, digest, Sha256::DIGEST_SIZE, out);
+    }
+
+    // Copies the stored digest; false when the stream predates digests
+    static bool stored(const vector<ExtensionRecord> &extensions, unsigned char *digest)
+    {
+        const ExtensionRecord *record = HeaderExtensions::find(extensions, Config::EXT_SHA256);
+        if (record == NULL)
+        {
+            return false;
+        }
+        if (record->data.size() != Sha256::DIGEST_SIZE)
+        {
+            throw InvalidFormatException("Corrupted file: invalid SHA-256 record");
+        }
+        memcpy(digest, record->data.data(), Sha256::DIGEST_SIZE);
+        return true;
+    }
+};
+
+// ============================================================================
+// PAYLOAD SIGNER CLASS
+// ============================================================================
+class PayloadSigner
+{
+public:
+    static vector<unsigned char> loadKey(const string &filename, size_t expectedSize)
+    {
+        vector<unsigned char> key = FileIOManager::readFile(filename);
+        if (key.size() != expectedSize)
+        {
+            throw InvalidFormatException("Invalid key file: " + filename);
+        }
+        return key;
+    }
+
+    // A secret key file is seed || publicKey. Signing with a public half that
+    // does not belong to the seed can leak the seed, so it is re-derived and
+    // compared.
+    static vector<unsigned char> loadSecretKey(const string &filename)
+    {
+        vector<unsigned char> secretKey = loadKey(filename, Ed25519::SECRET_KEY_SIZE);
+        vector<unsigned char> derived(secretKey.begin(), secretKey.end());
+        Ed25519::derivePublicKey(derived.data());
+        if (memcmp(derived.data() + 32, secretKey.data() + 32, Ed25519::PUBLIC_KEY_SIZE) != 0)
+        {
+            throw InvalidFormatException("Invalid key file: public key does not match the seed: " + filename);
+        }
+        return secretKey;
+    }
+
+    static void generateKeyPair(const string &prefix)
+    {
+        vector<unsigned char> secretKey(Ed25519::SECRET_KEY_SIZE);
+        Ed25519::generateSecretKey(secretKey.data());
+        vector<unsigned char> publicKey(secretKey.begin() + 32, secretKey.end());
+
+        FileIOManager::writePrivateFile(prefix + ".key", secretKey);
+        FileIOManager::writeFile(prefix + ".pub", publicKey);
+
+        cout << "Secret key: " << prefix << ".key" << endl;
+        cout << "Public key: " << prefix << ".pub" << endl;
+        cout << "Key id: " << Utils::toHex(publicKey.data(), publicKey.size()) << endl;
+    }
+
+    static void digestPayload(const unsigned char *payload, size_t length, unsigned char *digest)
+    {
+        Sha512::hash(payload, length, digest);
+    }
+
+    static size_t recordSize()
+    {
+        return 4 + Ed25519::PUBLIC_KEY_SIZE + Ed25519::SIGNATURE_SIZE;
+    }
+
+    // Signature record: publicKey (32) || signature over SHA-512(payload) (64)
+    static ExtensionRecord sign(const unsigned char *payload, size_t length,
+                                const vector<unsigned char> &secretKey)
+    {
+        unsigned char digest[Sha512::DIGEST_SIZE];
+        digestPayload(payload, length, digest);
+
+        vector<unsigned char> data(Ed25519::PUBLIC_KEY_SIZE + Ed25519::SIGNATURE_SIZE);
+        memcpy(data.data(), secretKey.data() + 32, Ed25519::PUBLIC_KEY_SIZE);
+        Ed25519::sign(data.data() + Ed25519::PUBLIC_KEY_SIZE, digest, sizeof(digest), secretKey.data());
+        return ExtensionRecord(Config::EXT_SIGNATURE, data);
+    }
+};
+
+// ============================================================================
+// STEGANOGRAPHY ENGINE CLASS
+// ============================================================================
+class UniversalSteganography
+{
+private:
+    string hiddenFilePath;
+    string hostFilePath;
+    string outputFilePath;
+    string signingKeyPath;
+    bool fastPathEnabled;
+    double deadlineMs;
+    bool appendFallback;
+    string tradeoffs;
+
+    StegoHeader createHeader(const string &hiddenFilename, size_t hiddenSize)
+    {
+        StegoHeader header;
+        header.hiddenFileSize = static_cast<uint32_t>(hiddenSize);
+
+        const char *filename = Utils::filenamePart(hiddenFilename.c_str());
+        header.filenameLength = min(strlen(filename),
+                                    static_cast<size_t>(Config::MAX_FILENAME_LENGTH - 1));
+
+        strncpy(header.filename, filename, header.filenameLength);
+        header.filename[header.filenameLength] = '\0';
+
+        header.checksum = header.calculateChecksum();
+        return header;
+    }
+
+    vector<unsigned char> serializeHeader(const StegoHeader &header)
+    {
+        vector<unsigned char> buffer(sizeof(StegoHeader));
+        memcpy(buffer.data(), &header, sizeof(StegoHeader));
+        return buffer;
+    }
+
+    static string formatMs(double microseconds)
+    {
+        ostringstream text;
+        text << fixed << setprecision(1) << microseconds / 1000.0 << " ms";
+        return text.str();
+    }
+
+    // Picks the effort level whose estimated cost fits the deadline. The only
+    // level below a host engine is plain append: the cover bytes stay intact
+    // and the data is found by the trailing header instead. That drops the
+    // covert embedding, so it is only taken when the caller allowed it;
+    // otherwise a host engine over the deadline fails the job.
+    HostFormat planEffort(HostFormat format, size_t hostSize, size_t streamSize)
+    {
+        const CostModel &model = CostModel::instance();
+        double budgetUs = deadlineMs * 1000.0;
+        double estimateUs = model.estimateUs(format, hostSize, streamSize);
+        if (estimateUs <= budgetUs)
+        {
+            cout << "      • Effort: full (estimated " << formatMs(estimateUs) << ", deadline "
+                 << formatMs(budgetUs) << ")" << endl;
+            return format;
+        }
+
+        if (format != HOST_APPEND && !appendFallback)
+        {
+            throw SteganographyException(string(HostDetector::name(format)) + " embedding is estimated at " +
+                                         formatMs(estimateUs) + ", over the " + formatMs(budgetUs) +
+                                         " deadline, and falling back to plain append was not allowed");
+        }
+        if (format != HOST_APPEND)
+        {
+            tradeoffs = string("plain append instead of ") + HostDetector::name(format) + " embedding (estimated " +
+                        formatMs(estimateUs) + " > deadline " + formatMs(budgetUs) + ")";
+            format = HOST_APPEND;
+            estimateUs = model.estimateUs(format, hostSize, streamSize);
+        }
+        if (estimateUs > budgetUs)
+        {
+            tradeoffs += string(tradeoffs.empty() ? "" : "; ") + "deadline cannot be met (cheapest level estimated " +
+                         formatMs(estimateUs) + ")";
+        }
+        cout << "      • Effort: " << tradeoffs << endl;
+        return format;
+    }
+
+    // Latency path for small unsigned payloads on appended covers: each file
+    // is opened once, the payload, header, digest record and output path stay
+    // in stack buffers (no heap allocation), the host is copied in the kernel
+    // into a fresh output inode and header + payload + digest record go out in
+    // one pwritev. Returns false, before anything is written or logged, when the
+    // job needs the general path.
+    bool hideSmallFile(char *finalOutputPath, size_t capacity)
+    {
+#ifdef __linux__
+        chrono::steady_clock::time_point started = chrono::steady_clock::now();
+        ScopedFd host(open(hostFilePath.c_str(), O_RDONLY | O_CLOEXEC));
+        ScopedFd hidden(open(hiddenFilePath.c_str(), O_RDONLY | O_CLOEXEC));
+        struct stat hostStat, hiddenStat;
+        if (host.get() < 0 || hidden.get() < 0 || fstat(host.get(), &hostStat) != 0 ||
+            fstat(hidden.get(), &hiddenStat) != 0 || !S_ISREG(hostStat.st_mode) ||
+            !S_ISREG(hiddenStat.st_mode) || static_cast<size_t>(hiddenStat.st_size) > Config::FAST_PATH_MAX_PAYLOAD)
+        {
+            return false;
+        }
+
+        unsigned char magic[HostDetector::MAGIC_SIZE];
+        ssize_t magicLength = pread(host.get(), magic, sizeof(magic), 0);
+        if (magicLength < 0 || HostDetector::hasEngineMagic(magic, static_cast<size_t>(magicLength)))
+        {
+            return false;
+        }
+
+        // In-place appends go through the general path
+        if (!Utils::composeOutputFilename(outputFilePath.c_str(), Utils::filenamePart(hostFilePath.c_str()),
+                                          finalOutputPath, capacity))
+        {
+            return false;
+        }
+        struct stat outStat;
+        if (stat(finalOutputPath, &outStat) == 0 &&
+            outStat.st_dev == hostStat.st_dev && outStat.st_ino == hostStat.st_ino)
+        {
+            return false;
+        }
+
+        JobProbe probe("encode", hostFilePath, started);
+        probe.phase(1, "validate");
+        size_t hostSize = static_cast<size_t>(hostStat.st_size);
+        size_t hiddenSize = static_cast<size_t>(hiddenStat.st_size);
+        FileValidator::validateAndCalculateMaxSize(hiddenSize, hostSize);
+
+        probe.phase(4, "read");
+        unsigned char payload[Config::FAST_PATH_MAX_PAYLOAD];
+        for (size_t done = 0; done < hiddenSize;)
+        {
+            ssize_t n = pread(hidden.get(), payload + done, hiddenSize - done, static_cast<off_t>(done));
+            if (n < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (n <= 0)
+            {
+                throw FileAccessException("Error reading file: " + hiddenFilePath);
+            }
+            done += static_cast<size_t>(n);
+        }
+        StegoHeader header = createHeader(hiddenFilePath, hiddenSize);
+        unsigned char digest[Sha256::DIGEST_SIZE];
+        Sha256::hash(payload, hiddenSize, digest);
+        unsigned char extensionData[PayloadDigest::EXTENSION_BLOCK_SIZE];
+        size_t extensionSize = PayloadDigest::writeBlock(digest, extensionData);
+
+        // A previous output is replaced by a new inode rather than truncated:
+        // ext4 starts writeback when a truncated-and-rewritten file is closed,
+        // which costs more than the rest of a small encode
+        probe.phase(5, "embed");
+        if (unlink(finalOutputPath) != 0 && errno != ENOENT)
+        {
+            throw FileAccessException(string("Cannot create output file: ") + finalOutputPath);
+        }
+        ScopedFd out(open(finalOutputPath, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644));
+        if (out.get() < 0)
+        {
+            throw FileAccessException(string("Cannot create output file: ") + finalOutputPath);
+        }
+        FileIOManager::CopyMethod method;
+        char copyBuffer[Config::FAST_PATH_COPY_BUFFER];
+        if (!FileIOManager::copyDescriptor(host.get(), out.get(), method, copyBuffer, sizeof(copyBuffer)))
+        {
+            throw FileAccessException(string("Error writing to file: ") + finalOutputPath);
+        }
+
+        struct iovec tail[3];
+        tail[0].iov_base = &header;
+        tail[0].iov_len = sizeof(header);
+        tail[1].iov_base = payload;
+        tail[1].iov_len = hiddenSize;
+        tail[2].iov_base = extensionData;
+        tail[2].iov_len = extensionSize;
+        size_t tailSize = sizeof(header) + hiddenSize + extensionSize;
+        for (size_t done = 0; done < tailSize;)
+        {
+            ssize_t n = pwritev(out.get(), tail, 3, static_cast<off_t>(hostSize + done));
+            if (n < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (n <= 0)
+            {
+                throw FileAccessException(string("Error writing to file: ") + finalOutputPath);
+            }
+            done += static_cast<size_t>(n);
+
+            // A short write drops the bytes already written from the vector
+            for (int i = 0; i < 3; i++)
+            {
+                size_t used = min(tail[i].iov_len, static_cast<size_t>(n));
+                tail[i].iov_base = static_cast<char *>(tail[i].iov_base) + used;
+                tail[i].iov_len -= used;
+                n -= static_cast<ssize_t>(used);
+            }
+        }
+        if (!out.closeNow())
+        {
+            throw FileAccessException(string("Error writing to file: ") + finalOutputPath);
+        }
+        size_t outputSize = hostSize + tailSize;
+        probe.complete(outputSize);
+
+        char hiddenText[32], outputText[32], digestText[2 * Sha256::DIGEST_SIZE + 1];
+        Utils::formatBytes(hiddenSize, hiddenText, sizeof(hiddenText));
+        Utils::formatBytes(outputSize, outputText, sizeof(outputText));
+        Utils::toHex(digest, sizeof(digest), digestText);
+        cout << "Fast path: " << hiddenText << " appended, host copied via "
+             << FileIOManager::copyMethodName(method) << endl;
+        cout << "Output file: " << finalOutputPath << endl;
+        cout << "Total size: " << outputText << endl;
+        cout << "Hidden file: " << header.filename << " (" << hiddenText << ")" << endl;
+        cout << "SHA-256: " << digestText << endl;
+        return true;
+#else
+        (void)finalOutputPath;
+        (void)capacity;
+        return false;
+#endif
+    }
+
+public:
+    UniversalSteganography(const string &hiddenFile,
+                           const string &hostFile,
+                           const string &outputFile)
+        : hiddenFilePath(hiddenFile),
+          hostFilePath(hostFile),
+          outputFilePath(outputFile),
+          fastPathEnabled(true),
+          deadlineMs(0),
+          appendFallback(false) {}
+
+    void setSigningKey(const string &keyFile)
+    {
+        signingKeyPath = keyFile;
+    }
+
+    // The benchmark turns this off to time the general path on the same job
+    void setFastPath(bool enabled)
+    {
+        fastPathEnabled = enabled;
+    }
+
+    // Encode time budget in milliseconds; without one there is no deadline
+    void setDeadline(const string &milliseconds)
+    {
+        char *end = NULL;
+        errno = 0;
+        double value = strtod(milliseconds.c_str(), &end);
+        if (milliseconds.empty() || *end != '\0' || errno == ERANGE || !(value > 0))
+        {
+            throw SteganographyException("Invalid deadline: " + milliseconds + " (expected a positive number of ms)");
+        }
+        deadlineMs = value;
+    }
+
+    // "append" lets a deadline replace the host engine with plain append
+    // instead of failing the encode; "none" (or empty) keeps the default
+    void setFallback(const string &level)
+    {
+        if (level != "append" && level != "none" && !level.empty())
+        {
+            throw SteganographyException("Invalid fallback: " + level + " (expected 'append' or 'none')");
+        }
+        appendFallback = level == "append";
+    }
+
+    // What hideFile gave up to meet the deadline; empty when nothing was
+    const string &tradeoffReport() const
+    {
+        return tradeoffs;
+    }
+
+    // Returns the path of the written stego file
+    string hideFile()
+    {
+        char fastOutput[Config::FAST_PATH_MAX_PATH];
+        if (fastPathEnabled && signingKeyPath.empty() && hideSmallFile(fastOutput, sizeof(fastOutput)))
+        {
+            return fastOutput;
+        }
+
+        JobProbe probe("encode", hostFilePath);
+        cout << "\n━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━" << endl;
+        cout << "  INITIATING FILE HIDING PROCESS" << endl;
+        cout << "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n"
+             << endl;
+
+        // Step 1: Validate file access
+        probe.phase(1, "validate");
+        cout << "[1/5] Validating file access..." << endl;
+        FileValidator::validateFileAccess(hiddenFilePath, "File to hide");
+        FileValidator::validateFileAccess(hostFilePath, "Host file");
+        cout << "      ✓ Files validated successfully\n"
+             << endl;
 
         // Step 2: Get file sizes
+        probe.phase(2, "analyze");
         cout << "[2/5] Analyzing file sizes..." << endl;
         size_t hiddenSize = Utils::getFileSize(hiddenFilePath);
         size_t hostSize = Utils::getFileSize(hostFilePath);
 
-        cout << "      • File to hide: " << Utils::formatBytes(hiddenSize)
-             << " (" << Utils::extractFilename(hiddenFilePath) << ")" << endl;
-        cout << "      • Host file: " << Utils::formatBytes(hostSize)
-             << " (" << Utils::extractFilename(hostFilePath) << ")" << endl;
+        cout << "      • File to hide: " << Utils::formatBytes(hiddenSize)
+             << " (" << Utils::extractFilename(hiddenFilePath) << ")" << endl;
+        cout << "      • Host file: " << Utils::formatBytes(hostSize)
+             << " (" << Utils::extractFilename(hostFilePath) << ")" << endl;
+        HostFormat format = HostDetector::detect(hostFilePath);
+        cout << "      • Host format: " << HostDetector::name(format) << endl;
+        size_t reserved = sizeof(ExtensionBlockHeader) + PayloadDigest::recordSize() +
+                          (signingKeyPath.empty() ? 0 : PayloadSigner::recordSize());
+        if (deadlineMs > 0)
+        {
+            format = planEffort(format, hostSize, sizeof(StegoHeader) + hiddenSize + reserved);
+        }
+
+        // Step 3: Validate size constraints
+        probe.phase(3, "capacity");
+        cout << "\n[3/5] Checking size constraints..." << endl;
+        size_t maxAllowed = 0;
+        vector<unsigned char> hostData;
+        vector<FloatRegion> floatRegions;
+        DicomPixelInfo dicomInfo = DicomPixelInfo();
+        SqliteFreelist freelist = SqliteFreelist();
+        if (format == HOST_QOI)
+        {
+            maxAllowed = FileValidator::validateStreamCapacity(hiddenSize, QoiEngine::capacity(hostFilePath), reserved);
+        }
+        else if (format == HOST_FLOAT_IMAGE)
+        {
+            hostData = FileIOManager::readFile(hostFilePath);
+            FloatImageEngine::parse(hostData, floatRegions);
+            size_t streamCapacity = FloatImageEngine::capacity(hostData, floatRegions);
+            maxAllowed = FileValidator::validateStreamCapacity(hiddenSize, streamCapacity, reserved);
+        }
+        else if (format == HOST_DICOM)
+        {
+            dicomInfo = DicomEngine::readInfo(hostFilePath);
+            cout << "      • Pixel data: " << dicomInfo.frames << " frame(s) of " << dicomInfo.columns << "x"
+                 << dicomInfo.rows << ", " << dicomInfo.bitsStored << " bits stored" << endl;
+            cout << "      • Frame capacity: " << Utils::formatBytes(dicomInfo.frameCapacity()) << endl;
+            maxAllowed = FileValidator::validateStreamCapacity(hiddenSize, DicomEngine::capacity(dicomInfo), reserved);
+        }
+        else if (format == HOST_SQLITE)
+        {
+            freelist = SqliteEngine::readFreelist(hostFilePath);
+            cout << "      • Free pages: " << freelist.leafPages.size() << " of " << freelist.pageCount
+                 << " (" << Utils::formatBytes(freelist.usableSize) << " usable each)" << endl;
+            maxAllowed = FileValidator::validateStreamCapacity(hiddenSize, SqliteEngine::capacity(freelist), reserved);
+        }
+        else
+        {
+            maxAllowed = FileValidator::validateAndCalculateMaxSize(hiddenSize, hostSize);
+        }
+        double utilizationPercent = (static_cast<double>(hiddenSize) / maxAllowed) * 100.0;
+        cout << "      ✓ Size check passed" << endl;
+        cout << "      • Capacity utilization: " << fixed << setprecision(1)
+             << utilizationPercent << "%" << endl;
+        cout << "      • Remaining capacity: "
+             << Utils::formatBytes(maxAllowed - hiddenSize) << "\n"
+             << endl;
+
+        // Step 4: Read files
+        probe.phase(4, "read");
+        cout << "[4/5] Reading files..." << endl;
+        vector<unsigned char> hiddenData = FileIOManager::readFile(hiddenFilePath);
+        cout << "      ✓ Hidden file loaded into memory\n"
+             << endl;
+
+        // Step 5: Create output with embedded data
+        probe.phase(5, "embed");
+        cout << "[5/5] Embedding hidden file..." << endl;
+        StegoHeader header = createHeader(hiddenFilePath, hiddenSize);
+        vector<unsigned char> headerData = serializeHeader(header);
+
+        // Extensions follow the hidden data: the SHA-256 digest, then the
+        // optional signature
+        unsigned char digest[Sha256::DIGEST_SIZE];
+        Sha256::hash(hiddenData.data(), hiddenData.size(), digest);
+        vector<ExtensionRecord> extensions(1, PayloadDigest::record(digest));
+        cout << "      • SHA-256: " << Utils::toHex(digest, sizeof(digest)) << endl;
+        if (!signingKeyPath.empty())
+        {
+            vector<unsigned char> secretKey = PayloadSigner::loadSecretKey(signingKeyPath);
+            extensions.push_back(PayloadSigner::sign(hiddenData.data(), hiddenData.size(), secretKey));
+            cout << "      • Signed by key: "
+                 << Utils::toHex(secretKey.data() + 32, Ed25519::PUBLIC_KEY_SIZE) << endl;
+        }
+        vector<unsigned char> extensionData = HeaderExtensions::serialize(extensions);
+
+        // Ensure output file has same extension as cover/host file
+        string finalOutputPath = Utils::generateOutputFilename(outputFilePath, Utils::extractFilename(hostFilePath));
+
+        size_t outputSize = 0;
+        if (format != HOST_APPEND)
+        {
+            // Stream: header + hidden + extensions, spread over pixel/sample bits
+            vector<unsigned char> stream;
+            stream.reserve(headerData.size() + hiddenData.size() + extensionData.size());
+            stream.insert(stream.end(), headerData.begin(), headerData.end());
+            stream.insert(stream.end(), hiddenData.begin(), hiddenData.end());
+            stream.insert(stream.end(), extensionData.begin(), extensionData.end());
+
+            if (format == HOST_QOI)
+            {
+                if (Utils::sameFile(hostFilePath, finalOutputPath))
+                {
+                    throw FileAccessException("Output file must differ from the QOI cover: " + finalOutputPath);
+                }
+                QoiEngine::embed(hostFilePath, finalOutputPath, stream);
+            }
+            else if (format == HOST_DICOM)
+            {
+                // All elements stay shared with the cover; only the pixel
+                // bytes that carry the stream are rewritten
+                if (!Utils::sameFile(hostFilePath, finalOutputPath))
+                {
+                    FileIOManager::CopyMethod method = FileIOManager::cloneFile(hostFilePath, finalOutputPath);
+                    cout << "      • Host copied via " << FileIOManager::copyMethodName(method) << endl;
+                }
+                DicomEngine::embed(finalOutputPath, stream);
+                cout << "      • Frames used: " << DicomEngine::framesNeeded(dicomInfo, stream.size())
+                     << " of " << dicomInfo.frames << endl;
+            }
+            else if (format == HOST_SQLITE)
+            {
+                if (!Utils::sameFile(hostFilePath, finalOutputPath))
+                {
+                    FileIOManager::CopyMethod method = FileIOManager::cloneFile(hostFilePath, finalOutputPath);
+                    cout << "      • Host copied via " << FileIOManager::copyMethodName(method) << endl;
+                }
+                SqliteEngine::embed(finalOutputPath, stream);
+                cout << "      • Pages written: " << SqliteEngine::pagesNeeded(freelist, stream.size())
+                     << " of " << freelist.leafPages.size() << " free" << endl;
+            }
+            else
+            {
+                FloatImageEngine::embed(hostData, floatRegions, stream);
+                FileIOManager::writeFile(finalOutputPath, hostData);
+            }
+            outputSize = Utils::getFileSize(finalOutputPath);
+        }
+        else
+        {
+            // Construct output: host + header + hidden + extensions. The host part is
+            // cloned, so on reflink-capable filesystems only the appended tail uses
+            // new blocks.
+            if (!Utils::sameFile(hostFilePath, finalOutputPath))
+            {
+                FileIOManager::CopyMethod method = FileIOManager::cloneFile(hostFilePath, finalOutputPath);
+                cout << "      • Host copied via " << FileIOManager::copyMethodName(method) << endl;
+            }
+
+            vector<const vector<unsigned char> *> tail;
+            tail.push_back(&headerData);
+            tail.push_back(&hiddenData);
+            tail.push_back(&extensionData);
+            FileIOManager::appendFile(finalOutputPath, tail);
+            outputSize = hostSize + headerData.size() + hiddenData.size() + extensionData.size();
+        }
+        probe.complete(outputSize);
+
+        cout << "      ✓ File embedded successfully" << endl;
+        cout << "\n━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━" << endl;
+        cout << "  ✓ OPERATION COMPLETED SUCCESSFULLY" << endl;
+        cout << "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n"
+             << endl;
+        cout << "Output file: " << finalOutputPath << endl;
+        cout << "Total size: " << Utils::formatBytes(outputSize) << endl;
+        cout << "Hidden file: " << header.filename << " ("
+             << Utils::formatBytes(hiddenSize) << ")" << endl;
+        if (!tradeoffs.empty())
+        {
+            cout << "Traded off: " << tradeoffs << endl;
+        }
+        return finalOutputPath;
+    }
+
+    // Returns the path of the extracted file
+    string extractFile()
+    {
+        JobProbe probe("decode", hostFilePath);
+        cout << "\n━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━" << endl;
+        cout << "  INITIATING FILE EXTRACTION PROCESS" << endl;
+        cout << "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n"
+             << endl;
+
+        // Step 1: Validate file access
+        probe.phase(1, "validate");
+        cout << "[1/4] Validating file access..." << endl;
+        FileValidator::validateFileAccess(hostFilePath, "Stego file");
+        cout << "      ✓ File validated\n"
+             << endl;
+
+        // Step 2: Read file
+        probe.phase(2, "read");
+        cout << "[2/4] Reading stego file..." << endl;
+        size_t fileSize = Utils::getFileSize(hostFilePath);
+        cout << "      • File size: " << Utils::formatBytes(fileSize) << endl;
+        cout << "      • Host format: " << HostDetector::name(HostDetector::detect(hostFilePath)) << "\n"
+             << endl;
+
+        // Step 3: Extract and validate header
+        probe.phase(3, "search");
+        cout << "[3/4] Searching for hidden data..." << endl;
+        if (fileSize < sizeof(StegoHeader))
+        {
+            throw InvalidFormatException("File too small to contain hidden data");
+        }
+
+        // Header is located after original host file data, or at the start
+        // of the LSB stream for pixel engines
+        vector<unsigned char> data;
+        size_t headerOffset = 0;
+        StegoHeader header;
+        if (!PayloadLocator::locate(hostFilePath, data, headerOffset, header))
+        {
+            throw InvalidFormatException("No hidden data found in file");
+        }
+
+        cout << "      ✓ Hidden data located" << endl;
+        cout << "      • Original filename: " << header.filename << endl;
+        cout << "      • Hidden file size: "
+             << Utils::formatBytes(header.hiddenFileSize) << "\n"
+             << endl;
+
+        // Step 4: Extract hidden data
+        probe.phase(4, "extract");
+        cout << "[4/4] Extracting hidden file..." << endl;
+        size_t hiddenDataOffset = headerOffset + sizeof(StegoHeader);
+
+        if (hiddenDataOffset + header.hiddenFileSize > data.size())
+        {
+            throw InvalidFormatException("Corrupted file: size mismatch");
+        }
+
+        vector<unsigned char> hiddenData(data.begin() + hiddenDataOffset,
+                                         data.begin() + hiddenDataOffset + header.hiddenFileSize);
+
+        // Files written before digests were added carry no SHA-256 record
+        unsigned char digest[Sha256::DIGEST_SIZE];
+        unsigned char storedDigest[Sha256::DIGEST_SIZE];
+        Sha256::hash(hiddenData.data(), hiddenData.size(), digest);
+        bool hasStoredDigest = PayloadDigest::stored(PayloadLocator::readExtensions(data, headerOffset, header),
+                                                     storedDigest);
+        if (hasStoredDigest && memcmp(digest, storedDigest, sizeof(digest)) != 0)
+        {
+            throw InvalidFormatException("Corrupted file: SHA-256 mismatch");
+        }
+        cout << "      • SHA-256: " << Utils::toHex(digest, sizeof(digest))
+             << (hasStoredDigest ? " (verified)" : " (no stored digest)") << endl;
+
+        // Generate output filename with proper extension preservation
+        string extractedFilename = Utils::generateOutputFilename(outputFilePath, header.filename);
+
+        FileIOManager::writeFile(extractedFilename, hiddenData);
+        probe.complete(hiddenData.size());
+
+        cout << "      ✓ File extracted successfully" << endl;
+        cout << "\n━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━" << endl;
+        cout << "  ✓ EXTRACTION COMPLETED SUCCESSFULLY" << endl;
+        cout << "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n"
+             << endl;
+        cout << "Extracted file: " << extractedFilename << endl;
+        cout << "File size: " << Utils::formatBytes(hiddenData.size()) << endl;
+        return extractedFilename;
+    }
+};
+
+// ============================================================================
+// PAYLOAD VERIFIER CLASS
+// ============================================================================
+struct PayloadInfo
+{
+    string path;
+    bool found;
+    StegoHeader header;
+    bool isSigned;
+    bool signatureValid;
+    unsigned char publicKey[Ed25519::PUBLIC_KEY_SIZE];
+    unsigned char signature[Ed25519::SIGNATURE_SIZE];
+    unsigned char digest[Sha512::DIGEST_SIZE];
+    bool hasSha256;
+    bool hasStoredSha256;
+    bool sha256Valid;
+    unsigned char sha256[Sha256::DIGEST_SIZE];
+    unsigned char storedSha256[Sha256::DIGEST_SIZE];
+    vector<unsigned char> pendingPayload; // small payloads wait for the batch digest
+    string error;
+
+    PayloadInfo()
+        : found(false), isSigned(false), signatureValid(false), hasSha256(false), hasStoredSha256(false),
+          sha256Valid(false) {}
+};
+
+class PayloadVerifier
+{
+public:
+    enum Mode
+    {
+        MODE_VERIFY,
+        MODE_SCAN,
+        MODE_INFO
+    };
+
+private:
+    static PayloadInfo inspect(const string &path)
+    {
+        PayloadInfo info;
+        info.path = path;
+        try
+        {
+            vector<unsigned char> data;
+            size_t headerOffset = 0;
+            if (!PayloadLocator::locate(path, data, headerOffset, info.header))
+            {
+                info.error = "no hidden data";
+                return info;
+            }
+            info.found = true;
+
+            vector<ExtensionRecord> extensions = PayloadLocator::readExtensions(data, headerOffset, info.header);
+            const unsigned char *payload = data.data() + headerOffset + sizeof(StegoHeader);
+            info.hasStoredSha256 = PayloadDigest::stored(extensions, info.storedSha256);
+            if (info.header.hiddenFileSize <= Config::DIGEST_BATCH_MAX_PAYLOAD)
+            {
+                info.pendingPayload.assign(payload, payload + info.header.hiddenFileSize);
+            }
+            else
+            {
+                Sha256::hash(payload, info.header.hiddenFileSize, info.sha256);
+                info.hasSha256 = true;
+            }
+
+            const ExtensionRecord *record = HeaderExtensions::find(extensions, Config::EXT_SIGNATURE);
+            if (record == NULL)
+            {
+                return info;
+            }
+            if (record->data.size() != Ed25519::PUBLIC_KEY_SIZE + Ed25519::SIGNATURE_SIZE)
+            {
+                info.error = "malformed signature record";
+                return info;
+            }
+
+            info.isSigned = true;
+            memcpy(info.publicKey, record->data.data(), Ed25519::PUBLIC_KEY_SIZE);
+            memcpy(info.signature, record->data.data() + Ed25519::PUBLIC_KEY_SIZE, Ed25519::SIGNATURE_SIZE);
+            PayloadSigner::digestPayload(payload, info.header.hiddenFileSize, info.digest);
+        }
+        catch (const SteganographyException &e)
+        {
+            info.error = e.what();
+        }
+        return info;
+    }
+
+    // Hashes the small payloads of a batch together, then checks every
+    // digest against the stored one
+    static void digestPayloads(vector<PayloadInfo> &batch)
+    {
+        vector<const unsigned char *> data;
+        vector<size_t> lengths;
+        vector<size_t> indices;
+        for (size_t i = 0; i < batch.size(); i++)
+        {
+            if (batch[i].pendingPayload.size() == batch[i].header.hiddenFileSize && !batch[i].hasSha256 &&
+                batch[i].found && batch[i].error.empty())
+            {
+                data.push_back(batch[i].pendingPayload.data());
+                lengths.push_back(batch[i].pendingPayload.size());
+                indices.push_back(i);
+            }
+        }
+
+        vector<unsigned char> digests(indices.size() * Sha256::DIGEST_SIZE);
+        Sha256::hashMany(data, lengths, digests.data());
+        STEGO_PROBE3(chunk_done, "digest_batch", indices.size(), true);
+        for (size_t k = 0; k < indices.size(); k++)
+        {
+            PayloadInfo &info = batch[indices[k]];
+            memcpy(info.sha256, &digests[k * Sha256::DIGEST_SIZE], Sha256::DIGEST_SIZE);
+            info.hasSha256 = true;
+            vector<unsigned char>().swap(info.pendingPayload);
+        }
+
+        for (size_t i = 0; i < batch.size(); i++)
+        {
+            PayloadInfo &info = batch[i];
+            if (!info.hasSha256 || !info.hasStoredSha256)
+            {
+                continue;
+            }
+            info.sha256Valid = memcmp(info.sha256, info.storedSha256, Sha256::DIGEST_SIZE) == 0;
+            if (!info.sha256Valid && info.error.empty())
+            {
+                info.error = "SHA-256 mismatch";
+            }
+        }
+    }
+
+    // Batch-verifies all signed entries; a failing batch is bisected to find
+    // the bad signatures.
+    static void verifySignatures(vector<PayloadInfo> &batch, const vector<unsigned char> &trustedKey)
+    {
+        vector<Ed25519::BatchEntry> entries;
+        vector<size_t> indices;
+        for (size_t i = 0; i < batch.size(); i++)
+        {
+            PayloadInfo &info = batch[i];
+            if (!info.isSigned)
+            {
+                continue;
+            }
+            if (!trustedKey.empty() && memcmp(info.publicKey, trustedKey.data(), Ed25519::PUBLIC_KEY_SIZE) != 0)
+            {
+                info.error = "signed by untrusted key";
+                continue;
+            }
+
+            Ed25519::BatchEntry entry;
+            entry.publicKey = info.publicKey;
+            entry.signature = info.signature;
+            entry.message = info.digest;
+            entry.messageLength = Sha512::DIGEST_SIZE;
+            entries.push_back(entry);
+            indices.push_back(i);
+        }
+
+        vector<bool> valid;
+        bool batchValid = Ed25519::verifyEach(entries, valid);
+        STEGO_PROBE3(chunk_done, "signature_batch", entries.size(), batchValid);
+        for (size_t k = 0; k < indices.size(); k++)
+        {
+            PayloadInfo &info = batch[indices[k]];
+            info.signatureValid = valid[k];
+            if (!info.signatureValid)
+            {
+                info.error = "signature mismatch";
+            }
+        }
+    }
+
+    static bool digestFailed(const PayloadInfo &info)
+    {
+        return info.hasSha256 && info.hasStoredSha256 && !info.sha256Valid;
+    }
+
+    static string digestStatus(const PayloadInfo &info)
+    {
+        if (!info.hasStoredSha256)
+        {
+            return "not stored";
+        }
+        if (info.sha256Valid)
+        {
+            return "verified";
+        }
+        return "MISMATCH, stored " + Utils::toHex(info.storedSha256, Sha256::DIGEST_SIZE);
+    }
+
+    static void reportInfo(const PayloadInfo &info, size_t &failures)
+    {
+        cout << info.path << endl;
+        cout << "  Host format: " << HostDetector::name(HostDetector::detect(info.path)) << endl;
+        if (!info.found)
+        {
+            cout << "  Hidden file: none (" << info.error << ")" << endl;
+            return;
+        }
+        cout << "  Hidden file: " << info.header.filename << " ("
+             << Utils::formatBytes(info.header.hiddenFileSize) << ")" << endl;
+        if (info.hasSha256)
+        {
+            cout << "  SHA-256: " << Utils::toHex(info.sha256, Sha256::DIGEST_SIZE) << " (" << digestStatus(info)
+                 << ")" << endl;
+        }
+        if (info.isSigned)
+        {
+            cout << "  Signature: " << (info.signatureValid ? "valid" : "INVALID") << ", key "
+                 << Utils::toHex(info.publicKey, Ed25519::PUBLIC_KEY_SIZE) << endl;
+        }
+        else
+        {
+            cout << "  Signature: none" << endl;
+        }
+        if (!info.error.empty())
+        {
+            cout << "  Error: " << info.error << endl;
+        }
+        if (digestFailed(info) || (info.isSigned && !info.signatureValid))
+        {
+            failures++;
+        }
+    }
+
+    static void report(const PayloadInfo &info, Mode mode, size_t &failures)
+    {
+        if (mode == MODE_INFO)
+        {
+            reportInfo(info, failures);
+            return;
+        }
+        if (mode == MODE_SCAN)
+        {
+            cout << info.path << ": ";
+            if (!info.found)
+            {
+                cout << info.error << endl;
+                return;
+            }
+            cout << info.header.filename << " (" << Utils::formatBytes(info.header.hiddenFileSize) << ")";
+            if (info.hasSha256)
+            {
+                cout << " sha256: " << Utils::toHex(info.sha256, Sha256::DIGEST_SIZE);
+            }
+            if (info.isSigned)
+            {
+                cout << " signature: " << (info.signatureValid ? "valid" : "INVALID")
+                     << " key: " << Utils::toHex(info.publicKey, Ed25519::PUBLIC_KEY_SIZE);
+            }
+            else
+            {
+                cout << " signature: none";
+            }
+            if (!info.error.empty())
+            {
+                cout << " (" << info.error << ")";
+            }
+            cout << endl;
+            if (digestFailed(info) || (info.isSigned && !info.signatureValid))
+            {
+                failures++;
+            }
+            return;
+        }
+
+        if (info.signatureValid && !digestFailed(info))
+        {
+            cout << "VALID   " << info.path << " (" << info.header.filename << ", key "
+                 << Utils::toHex(info.publicKey, Ed25519::PUBLIC_KEY_SIZE) << ")" << endl;
+            return;
+        }
+        failures++;
+        string reason = info.error;
+        if (reason.empty())
+        {
+            reason = info.found ? "payload is not signed" : "no hidden data";
+        }
+        cout << "INVALID " << info.path << ": " << reason << endl;
+    }
+
+public:
+    // verify: every file must carry a valid signature
+    // scan:   one line of payload metadata per file, signature where present
+    // info:   the same in detail, one block per file
+    // A stored SHA-256 that does not match the payload fails in every mode.
+    static int run(const vector<string> &files, const string &publicKeyPath, Mode mode)
+    {
+        const char *modeNames[] = {"verify", "scan", "info"};
+        JobProbe probe(modeNames[mode], publicKeyPath);
+        vector<unsigned char> trustedKey;
+        if (!publicKeyPath.empty())
+        {
+            trustedKey = PayloadSigner::loadKey(publicKeyPath, Ed25519::PUBLIC_KEY_SIZE);
+        }
+
+        size_t failures = 0;
+        size_t signedCount = 0;
+        for (size_t start = 0; start < files.size(); start += Config::VERIFY_BATCH_SIZE)
+        {
+            size_t end = min(files.size(), start + Config::VERIFY_BATCH_SIZE);
+            vector<PayloadInfo> batch;
+            batch.reserve(end - start);
+            for (size_t i = start; i < end; i++)
+            {
+                batch.push_back(inspect(files[i]));
+                signedCount += batch.back().isSigned ? 1 : 0;
+                STEGO_PROBE2(queue_push, files[i].c_str(), batch.size());
+            }
+
+            STEGO_PROBE1(queue_flush, batch.size());
+            digestPayloads(batch);
+            verifySignatures(batch, trustedKey);
+            for (size_t i = 0; i < batch.size(); i++)
+            {
+                report(batch[i], mode, failures);
+            }
+        }
+
+        cout << "\nFiles: " << files.size() << ", signed: " << signedCount
+             << ", failed: " << failures << endl;
+        probe.complete(files.size());
+        return failures == 0 ? 0 : 1;
+    }
+};
+
+// ============================================================================
+// OBJECT STORE
+// ============================================================================
+// A directory of covers used as one store. Each cover carries at most one
+// slot: an ordinary stego stream whose header filename marks it as an extent
+// of a stored object or as the store index. The index lives in one of the
+// covers (the root) and maps object names to their extents.
+//   extent payload: [StoreExtentHeader][object bytes]
+//   index payload:  [magic][generation][nextId][covers][objects][checksum]
+struct StoreExtentHeader
+{
+    uint32_t magic;
+    uint32_t objectId;
+    uint32_t index;
+    uint32_t length;
+    uint32_t checksum;
+};
+
+struct StoreCover
+{
+    string name;
+    HostFormat format;
+    uint64_t baseSize; // appended covers: size before a slot was added
+    uint64_t capacity; // slot payload bytes
+};
+
+struct StoreExtent
+{
+    uint32_t cover;
+    uint32_t length;
+};
+
+struct StoreObject
+{
+    string name;
+    uint32_t id;
+    uint64_t size;
+    vector<StoreExtent> extents;
+};
+
+// Reads and rewrites the slot of one cover in place
+class CoverSlot
+{
+private:
+    static StegoHeader makeHeader(const char *marker, size_t payloadSize)
+    {
+        StegoHeader header;
+        header.hiddenFileSize = static_cast<uint32_t>(payloadSize);
+        header.filenameLength = static_cast<uint16_t>(strlen(marker));
+        memcpy(header.filename, marker, header.filenameLength);
+        header.checksum = header.calculateChecksum();
+        return header;
+    }
+
+    static bool isSlot(const StegoHeader &header, const char *marker)
+    {
+        return header.validate() && header.filenameLength == strlen(marker) &&
+               memcmp(header.filename, marker, header.filenameLength) == 0;
+    }
+
+    static void writeStream(const string &path, HostFormat format, const vector<unsigned char> &stream)
+    {
+        if (format == HOST_QOI)
+        {
+            // The pixels are re-encoded, so the image is rebuilt beside the
+            // cover and renamed over it
+            string name = Utils::extractFilename(path);
+            string temporary = path.substr(0, path.size() - name.size()) + "." + name + ".tmp";
+            QoiEngine::embed(path, temporary, stream);
+#ifdef _WIN32
+            remove(path.c_str());
+#endif
+            if (rename(temporary.c_str(), path.c_str()) != 0)
+            {
+                remove(temporary.c_str());
+                throw FileAccessException("Error writing to file: " + path);
+            }
+        }
+        else if (format == HOST_FLOAT_IMAGE)
+        {
+            vector<unsigned char> file = FileIOManager::readFile(path);
+            vector<FloatRegion> regions;
+            FloatImageEngine::parse(file, regions);
+            FloatImageEngine::embed(file, regions, stream);
+            FileIOManager::writeFile(path, file);
+        }
+        else if (format == HOST_DICOM)
+        {
+            DicomEngine::embed(path, stream);
+        }
+        else
+        {
+            SqliteEngine::embed(path, stream);
+        }
+    }
+
+public:
+    // Slot payload bytes of a cover that holds no slot yet
+    static uint64_t capacity(const string &path, HostFormat format)
+    {
+        size_t streamCapacity = 0;
+        if (format == HOST_QOI)
+        {
+            streamCapacity = QoiEngine::capacity(path);
+        }
+        else if (format == HOST_FLOAT_IMAGE)
+        {
+            vector<unsigned char> file = FileIOManager::readFile(path);
+            vector<FloatRegion> regions;
+            FloatImageEngine::parse(file, regions);
+            streamCapacity = FloatImageEngine::capacity(file, regions);
+        }
+        else if (format == HOST_DICOM)
+        {
+            streamCapacity = DicomEngine::capacity(DicomEngine::readInfo(path));
+        }
+        else if (format == HOST_SQLITE)
+        {
+            streamCapacity = SqliteEngine::capacity(SqliteEngine::readFreelist(path));
+        }
+        else
+        {
+            size_t size = Utils::getFileSize(path);
+            streamCapacity = size < Config::MIN_HOST_SIZE ? 0 : static_cast<size_t>(size * Config::MAX_HIDDEN_SIZE_RATIO);
+        }
+        if (streamCapacity <= sizeof(StegoHeader))
+        {
+            return 0;
+        }
+        return min<uint64_t>(streamCapacity - sizeof(StegoHeader), UINT32_MAX);
+    }
+
+    static void write(const StoreCover &cover, const string &path, const char *marker,
+                      const vector<unsigned char> &payload)
+    {
+        StegoHeader header = makeHeader(marker, payload.size());
+        vector<unsigned char> headerData(sizeof(StegoHeader));
+        memcpy(headerData.data(), &header, sizeof(StegoHeader));
+
+        if (cover.format == HOST_APPEND)
+        {
+            if (Utils::getFileSize(path) != cover.baseSize)
+            {
+                FileIOManager::truncateFile(path, cover.baseSize);
+            }
+            vector<const vector<unsigned char> *> tail;
+            tail.push_back(&headerData);
+            tail.push_back(&payload);
+            FileIOManager::appendFile(path, tail);
+            return;
+        }
+
+        vector<unsigned char> stream(headerData);
+        stream.insert(stream.end(), payload.begin(), payload.end());
+        writeStream(path, cover.format, stream);
+    }
+
+    // Appended slots are read with two positioned reads at the base size;
+    // engine slots are decoded only as far as the stream goes, and no further
+    // than the header when it belongs to another slot
+    static bool read(const StoreCover &cover, const string &path, const char *marker, vector<unsigned char> &payload)
+    {
+        StegoHeader header;
+        if (cover.format == HOST_APPEND)
+        {
+            PageFile file(path, false);
+            if (!file.readAt(cover.baseSize, reinterpret_cast<unsigned char *>(&header), sizeof(header)) ||
+                !isSlot(header, marker))
+            {
+                return false;
+            }
+            payload.resize(header.hiddenFileSize);
+            return file.readAt(cover.baseSize + sizeof(header), payload.data(), payload.size());
+        }
+
+        vector<unsigned char> stream;
+        if (!PayloadLocator::extractStream(path, cover.format, stream, marker))
+        {
+            return false;
+        }
+        memcpy(&header, stream.data(), sizeof(header));
+        if (!isSlot(header, marker) || stream.size() < sizeof(header) + header.hiddenFileSize)
+        {
+            return false;
+        }
+        payload.assign(stream.begin() + sizeof(header), stream.begin() + sizeof(header) + header.hiddenFileSize);
+        return true;
+    }
+
+    // Used to find the root before the index (and so the base size of an
+    // appended cover) is known: the slot must end the file's tail window
+    static bool probe(const string &path, HostFormat format, const char *marker, vector<unsigned char> &payload)
+    {
+        if (format != HOST_APPEND)
+        {
+            StoreCover cover;
+            cover.format = format;
+            cover.baseSize = 0;
+            return read(cover, path, marker, payload);
+        }
+
+        size_t fileSize = Utils::getFileSize(path);
+        size_t window = min(fileSize, Config::STORE_INDEX_WINDOW);
+        vector<unsigned char> tail(window);
+        PageFile file(path, false);
+        size_t offset = 0;
+        StegoHeader header;
+        if (!file.readAt(fileSize - window, tail.data(), window) ||
+            !PayloadLocator::findHeader(tail, offset, header) || !isSlot(header, marker) ||
+            offset + sizeof(header) + header.hiddenFileSize != window)
+        {
+            return false;
+        }
+        payload.assign(tail.begin() + offset + sizeof(header), tail.end());
+        return true;
+    }
+
+    // Appended covers get their original bytes back; engine covers keep the
+    // carrier bits, so the old stream is overwritten with noise
+    static void clear(const StoreCover &cover, const string &path, size_t payloadSize)
+    {
+        if (cover.format == HOST_APPEND)
+        {
+            FileIOManager::truncateFile(path, cover.baseSize);
+            return;
+        }
+
+        random_device seed;
+        mt19937 rng(seed());
+        vector<unsigned char> noise(sizeof(StegoHeader) + payloadSize);
+        for (size_t i = 0; i < noise.size(); i++)
+        {
+            noise[i] = static_cast<unsigned char>(rng());
+        }
+        writeStream(path, cover.format, noise);
+    }
+};
+
+class StoreIndex
+{
+private:
+    static void put(vector<unsigned char> &out, uint64_t value, int bytes)
+    {
+        for (int i = 0; i < bytes; i++)
+        {
+            out.push_back(static_cast<unsigned char>(value >> (8 * i)));
+        }
+    }
+
+    static void putString(vector<unsigned char> &out, const string &text)
+    {
+        put(out, text.size(), 2);
+        out.insert(out.end(), text.begin(), text.end());
+    }
+
+    static bool get(const vector<unsigned char> &in, size_t &pos, uint64_t &value, int bytes)
+    {
+        if (in.size() - pos < static_cast<size_t>(bytes))
+        {
+            return false;
+        }
+        value = 0;
+        for (int i = 0; i < bytes; i++)
+        {
+            value |= static_cast<uint64_t>(in[pos++]) << (8 * i);
+        }
+        return true;
+    }
+
+    static bool getString(const vector<unsigned char> &in, size_t &pos, string &text)
+    {
+        uint64_t length = 0;
+        if (!get(in, pos, length, 2) || in.size() - pos < length)
+        {
+            return false;
+        }
+        text.assign(in.begin() + pos, in.begin() + pos + length);
+        pos += length;
+        return true;
+    }
+
+public:
+    uint64_t generation;
+    uint32_t nextId;
+    vector<StoreCover> covers;
+    vector<StoreObject> objects;
+
+    StoreIndex() : generation(0), nextId(1) {}
+
+    // FNV-1a
+    static uint32_t checksum(const unsigned char *data, size_t length)
+    {
+        uint32_t hash = 2166136261u;
+        for (size_t i = 0; i < length; i++)
+        {
+            hash = (hash ^ data[i]) * 16777619u;
+        }
+        return hash;
+    }
+
+    vector<unsigned char> serialize() const
+    {
+        vector<unsigned char> out;
+        put(out, Config::STORE_INDEX_MAGIC, 4);
+        put(out, generation, 8);
+        put(out, nextId, 4);
+        put(out, covers.size(), 4);
+        for (size_t i = 0; i < covers.size(); i++)
+        {
+            putString(out, covers[i].name);
+            put(out, covers[i].format, 1);
+            put(out, covers[i].baseSize, 8);
+            put(out, covers[i].capacity, 8);
+        }
+        put(out, objects.size(), 4);
+        for (size_t i = 0; i < objects.size(); i++)
+        {
+            const StoreObject &object = objects[i];
+            putString(out, object.name);
+            put(out, object.id, 4);
+            put(out, object.size, 8);
+            put(out, object.extents.size(), 4);
+            for (size_t e = 0; e < object.extents.size(); e++)
+            {
+                put(out, object.extents[e].cover, 4);
+                put(out, object.extents[e].length, 4);
+            }
+        }
+        put(out, checksum(out.data(), out.size()), 4);
+        return out;
+    }
+
+    bool parse(const vector<unsigned char> &in)
+    {
+        uint64_t magic = 0, sum = 0, count = 0, value = 0;
+        if (in.size() < 4)
+        {
+            return false;
+        }
+        size_t pos = in.size() - 4;
+        if (!get(in, pos, sum, 4) || sum != checksum(in.data(), in.size() - 4))
+        {
+            return false;
+        }
+
+        pos = 0;
+        if (!get(in, pos, magic, 4) || magic != Config::STORE_INDEX_MAGIC || !get(in, pos, generation, 8) ||
+            !get(in, pos, value, 4) || !get(in, pos, count, 4))
+        {
+            return false;
+        }
+        nextId = static_cast<uint32_t>(value);
+        covers.assign(min<uint64_t>(count, in.size()), StoreCover());
+        for (size_t i = 0; i < covers.size(); i++)
+        {
+            StoreCover &cover = covers[i];
+            if (!getString(in, pos, cover.name) || !get(in, pos, value, 1) || value >= HOST_FORMAT_COUNT ||
+                !get(in, pos, cover.baseSize, 8) || !get(in, pos, cover.capacity, 8))
+            {
+                return false;
+            }
+            cover.format = static_cast<HostFormat>(value);
+        }
+
+        if (covers.size() != count || !get(in, pos, count, 4))
+        {
+            return false;
+        }
+        objects.assign(min<uint64_t>(count, in.size()), StoreObject());
+        for (size_t i = 0; i < objects.size(); i++)
+        {
+            StoreObject &object = objects[i];
+            uint64_t extents = 0;
+            if (!getString(in, pos, object.name) || !get(in, pos, value, 4) || !get(in, pos, object.size, 8) ||
+                !get(in, pos, extents, 4) || extents > in.size())
+            {
+                return false;
+            }
+            object.id = static_cast<uint32_t>(value);
+            object.extents.resize(extents);
+            for (size_t e = 0; e < object.extents.size(); e++)
+            {
+                uint64_t cover = 0, length = 0;
+                if (!get(in, pos, cover, 4) || cover >= covers.size() || !get(in, pos, length, 4))
+                {
+                    return false;
+                }
+                object.extents[e].cover = static_cast<uint32_t>(cover);
+                object.extents[e].length = static_cast<uint32_t>(length);
+            }
+        }
+        return objects.size() == count && pos == in.size() - 4;
+    }
+
+    int findCover(const string &name) const
+    {
+        for (size_t i = 0; i < covers.size(); i++)
+        {
+            if (covers[i].name == name)
+            {
+                return static_cast<int>(i);
+            }
+        }
+        return -1;
+    }
+
+    int findObject(const string &name) const
+    {
+        for (size_t i = 0; i < objects.size(); i++)
+        {
+            if (objects[i].name == name)
+            {
+                return static_cast<int>(i);
+            }
+        }
+        return -1;
+    }
+};
+
+// Objects are split into extents placed by cover capacity: the smallest
+// free cover that holds the whole object, otherwise the largest free covers
+// first. Extents are written and read in parallel, one cover per task.
+class ObjectStore
+{
+private:
+    static const char *const INDEX_MARKER;
+    static const char *const EXTENT_MARKER;
+
+    string directory;
+    StoreIndex index;
+    vector<bool> present;
+    vector<bool> reserved;
+    int root;
+    size_t rootPayloadSize;
+
+    string coverPath(size_t cover) const
+    {
+        return directory + "/" + index.covers[cover].name;
+    }
+
+    // Runs job(0..count-1) on up to STORE_IO_THREADS threads; the first
+    // failure stops the remaining jobs and is rethrown here
+    static void parallelFor(size_t count, const function<void(size_t)> &job)
+    {
+        size_t threads = min(count, min(Config::STORE_IO_THREADS,
+                                        static_cast<size_t>(max(1u, thread::hardware_concurrency()))));
+        if (threads <= 1)
+        {
+            for (size_t i = 0; i < count; i++)
+            {
+                job(i);
+            }
+            return;
+        }
+
+        atomic<size_t> next(0);
+        mutex errorMutex;
+        exception_ptr error;
+        vector<thread> workers;
+        for (size_t t = 0; t < threads; t++)
+        {
+            workers.push_back(thread([&]() {
+                for (size_t i = next++; i < count; i = next++)
+                {
+                    try
+                    {
+                        job(i);
+                    }
+                    catch (...)
+                    {
+                        lock_guard<mutex> lock(errorMutex);
+                        if (!error)
+                        {
+                            error = current_exception();
+                        }
+                        next = count;
+                    }
+                }
+            }));
+        }
+        for (size_t t = 0; t < workers.size(); t++)
+        {
+            workers[t].join();
+        }
+        if (error)
+        {
+            rethrow_exception(error);
+        }
+    }
+
+    // The root is kept in the first STORE_ROOT_COVERS covers in name order,
+    // which are probed as one batch. The rest are searched only when it is
+    // not there: a new store, or covers added ahead of it since the last write.
+    void loadIndex(const vector<string> &names)
+    {
+        for (size_t start = 0; start < names.size() && root < 0; start += Config::STORE_ROOT_COVERS)
+        {
+            size_t count = min(Config::STORE_ROOT_COVERS, names.size() - start);
+            vector<StoreIndex> candidates(count);
+            vector<size_t> sizes(count, 0);
+            vector<char> found(count, 0);
+            parallelFor(count, [&](size_t i) {
+                string path = directory + "/" + names[start + i];
+                vector<unsigned char> payload;
+                try
+                {
+                    found[i] = CoverSlot::probe(path, HostDetector::detect(path), INDEX_MARKER, payload) &&
+                               candidates[i].parse(payload);
+                }
+                catch (const SteganographyException &)
+                {
+                    found[i] = 0;
+                }
+                sizes[i] = payload.size();
+            });
+
+            // Two roots only exist after an interrupted move; the newer wins
+            int best = -1;
+            for (size_t i = 0; i < count; i++)
+            {
+                if (found[i] && (best < 0 || candidates[i].generation > candidates[best].generation))
+                {
+                    best = static_cast<int>(i);
+                }
+            }
+            if (best >= 0)
+            {
+                index = candidates[best];
+                root = index.findCover(names[start + best]);
+                rootPayloadSize = sizes[best];
+                if (root < 0)
+                {
+                    throw InvalidFormatException("Store index does not list its own cover: " + names[start + best]);
+                }
+            }
+        }
+    }
+
+    void registerCovers(const vector<string> &names)
+    {
+        vector<string> fresh;
+        for (size_t i = 0; i < names.size(); i++)
+        {
+            if (index.findCover(names[i]) < 0)
+            {
+                fresh.push_back(names[i]);
+            }
+        }
+
+        size_t first = index.covers.size();
+        index.covers.resize(first + fresh.size());
+        parallelFor(fresh.size(), [&](size_t i) {
+            StoreCover &cover = index.covers[first + i];
+            string path = directory + "/" + fresh[i];
+            cover.name = fresh[i];
+            cover.format = HostDetector::detect(path);
+            cover.baseSize = cover.format == HOST_APPEND ? Utils::getFileSize(path) : 0;
+            try
+            {
+                cover.capacity = CoverSlot::capacity(path, cover.format);
+            }
+            catch (const SteganographyException &)
+            {
+                cover.capacity = 0;
+            }
+        });
+
+        present.assign(index.covers.size(), false);
+        reserved.assign(index.covers.size(), false);
+        for (size_t i = 0; i < names.size(); i++)
+        {
+            present[index.findCover(names[i])] = true;
+            reserved[index.findCover(names[i])] = i < Config::STORE_ROOT_COVERS;
+        }
+    }
+
+    vector<bool> usedCovers() const
+    {
+        vector<bool> used(index.covers.size(), false);
+        if (root >= 0)
+        {
+            used[root] = true;
+        }
+        for (size_t i = 0; i < index.objects.size(); i++)
+        {
+            const vector<StoreExtent> &extents = index.objects[i].extents;
+            for (size_t e = 0; e < extents.size(); e++)
+            {
+                used[extents[e].cover] = true;
+            }
+        }
+        return used;
+    }
+
+    bool usable(size_t cover, const vector<bool> &used) const
+    {
+        return present[cover] && !used[cover] && index.covers[cover].capacity > sizeof(StoreExtentHeader);
+    }
+
+    vector<StoreExtent> allocate(uint64_t size, const vector<bool> &used) const
+    {
+        const uint64_t overhead = sizeof(StoreExtentHeader);
+
+        // The covers kept for the root take extents only when the rest are full
+        uint64_t spare = 0;
+        for (size_t c = 0; c < index.covers.size(); c++)
+        {
+            if (usable(c, used) && !reserved[c])
+            {
+                spare += index.covers[c].capacity - overhead;
+            }
+        }
+        bool useReserved = spare < size;
+
+        vector<size_t> candidates;
+        int best = -1;
+        for (size_t c = 0; c < index.covers.size(); c++)
+        {
+            if (!usable(c, used) || (reserved[c] && !useReserved))
+            {
+                continue;
+            }
+            candidates.push_back(c);
+            uint64_t capacity = index.covers[c].capacity;
+            if (capacity - overhead >= size && (best < 0 || capacity < index.covers[best].capacity))
+            {
+                best = static_cast<int>(c);
+            }
+        }
+
+        vector<StoreExtent> extents;
+        StoreExtent extent;
+        if (best >= 0)
+        {
+            extent.cover = static_cast<uint32_t>(best);
+            extent.length = static_cast<uint32_t>(size);
+            extents.push_back(extent);
+            return extents;
+        }
+
+        // Largest covers first keeps the extent count low
+        sort(candidates.begin(), candidates.end(), [&](size_t a, size_t b) {
+            return index.covers[a].capacity > index.covers[b].capacity;
+        });
+        uint64_t remaining = size;
+        for (size_t i = 0; i < candidates.size() && remaining > 0; i++)
+        {
+            extent.cover = static_cast<uint32_t>(candidates[i]);
+            extent.length = static_cast<uint32_t>(min(remaining, index.covers[candidates[i]].capacity - overhead));
+            extents.push_back(extent);
+            remaining -= extent.length;
+        }
+        if (remaining > 0)
+        {
+            throw FileSizeException("Not enough free cover capacity to store " + Utils::formatBytes(size) +
+                                    " (" + Utils::formatBytes(size - remaining) + " free)");
+        }
+        return extents;
+    }
+
+    // The root stays where it is while it is in a reserved cover and the
+    // index fits; otherwise it moves to the first free reserved cover in name
+    // order that holds it, or failing that, the first free cover. Chosen
+    // before any extent is written, so a store that cannot take the index is
+    // untouched.
+    int planRoot(size_t indexSize, const vector<bool> &used) const
+    {
+        if (indexSize + sizeof(StegoHeader) > Config::STORE_INDEX_WINDOW)
+        {
+            throw FileSizeException("Store index exceeds " + Utils::formatBytes(Config::STORE_INDEX_WINDOW));
+        }
+        bool rootFits = root >= 0 && index.covers[root].capacity >= indexSize;
+        if (rootFits && reserved[root])
+        {
+            return root;
+        }
+
+        int target = -1;
+        for (size_t c = 0; c < index.covers.size(); c++)
+        {
+            if (present[c] && !used[c] && index.covers[c].capacity >= indexSize &&
+                (target < 0 || reserved[c] > reserved[target] ||
+                 (reserved[c] == reserved[target] && index.covers[c].name < index.covers[target].name)))
+            {
+                target = static_cast<int>(c);
+            }
+        }
+        if (rootFits && (target < 0 || !reserved[target]))
+        {
+            return root;
+        }
+        if (target < 0)
+        {
+            throw FileSizeException("No free cover left that can hold the store index");
+        }
+        return target;
+    }
+
+    void writeIndex(int target, const vector<unsigned char> &payload)
+    {
+        CoverSlot::write(index.covers[target], coverPath(target), INDEX_MARKER, payload);
+        if (root >= 0 && root != target)
+        {
+            CoverSlot::clear(index.covers[root], coverPath(root), rootPayloadSize);
+        }
+        root = target;
+        rootPayloadSize = payload.size();
+    }
+
+    // Serializes the updated index and picks its cover; `used` must still
+    // include any extents that are dropped by this update
+    int prepareIndex(vector<unsigned char> &payload, const vector<bool> &used)
+    {
+        index.generation++;
+        payload = index.serialize();
+        return planRoot(payload.size(), used);
+    }
+
+    void scrub(const StoreObject &object)
+    {
+        parallelFor(object.extents.size(), [&](size_t i) {
+            const StoreExtent &extent = object.extents[i];
+            CoverSlot::clear(index.covers[extent.cover], coverPath(extent.cover),
+                             sizeof(StoreExtentHeader) + extent.length);
+        });
+    }
+
+    static vector<size_t> extentOffsets(const StoreObject &object)
+    {
+        vector<size_t> offsets(object.extents.size(), 0);
+        for (size_t i = 1; i < offsets.size(); i++)
+        {
+            offsets[i] = offsets[i - 1] + object.extents[i - 1].length;
+        }
+        return offsets;
+    }
+
+public:
+    explicit ObjectStore(const string &coverDirectory)
+        : directory(coverDirectory), root(-1), rootPayloadSize(0)
+    {
+        vector<string> names = Utils::listFiles(directory);
+        if (names.empty())
+        {
+            throw FileAccessException("Cover directory is empty or not accessible: " + directory);
+        }
+        loadIndex(names);
+        registerCovers(names);
+    }
+
+    void put(const string &sourcePath, const string &name)
+    {
+        FileValidator::validateFileAccess(sourcePath, "File to store");
+        if (name.empty() || name.size() >= Config::MAX_FILENAME_LENGTH)
+        {
+            throw SteganographyException("Object names must be 1 to " +
+                                         to_string(Config::MAX_FILENAME_LENGTH - 1) + " bytes long");
+        }
+        vector<unsigned char> data = FileIOManager::readFile(sourcePath);
+
+        // A replaced object keeps its covers until the new index is written
+        vector<bool> used = usedCovers();
+        StoreObject object;
+        object.name = name;
+        object.id = index.nextId++;
+        object.size = data.size();
+        object.extents = allocate(data.size(), used);
+        for (size_t i = 0; i < object.extents.size(); i++)
+        {
+            used[object.extents[i].cover] = true;
+        }
+
+        int existing = index.findObject(name);
+        StoreObject previous;
+        if (existing >= 0)
+        {
+            previous = index.objects[existing];
+            index.objects[existing] = object;
+        }
+        else
+        {
+            index.objects.push_back(object);
+        }
+        vector<unsigned char> indexData;
+        int target = prepareIndex(indexData, used);
+
+        vector<size_t> offsets = extentOffsets(object);
+        parallelFor(object.extents.size(), [&](size_t i) {
+            const StoreExtent &extent = object.extents[i];
+            StoreExtentHeader header;
+            header.magic = Config::STORE_EXTENT_MAGIC;
+            header.objectId = object.id;
+            header.index = static_cast<uint32_t>(i);
+            header.length = extent.length;
+            header.checksum = StoreIndex::checksum(data.data() + offsets[i], extent.length);
+
+            vector<unsigned char> payload(sizeof(header) + extent.length);
+            memcpy(payload.data(), &header, sizeof(header));
+            memcpy(payload.data() + sizeof(header), data.data() + offsets[i], extent.length);
+            CoverSlot::write(index.covers[extent.cover], coverPath(extent.cover), EXTENT_MARKER, payload);
+        });
+        writeIndex(target, indexData);
+        scrub(previous);
+
+        cout << "Stored " << name << " (" << Utils::formatBytes(data.size()) << ") in "
+             << object.extents.size() << " extent(s)" << endl;
+    }
+
+    void get(const string &name, const string &outputPath)
+    {
+        int found = index.findObject(name);
+        if (found < 0)
+        {
+            throw FileAccessException("No object named " + name + " in " + directory);
+        }
+        const StoreObject &object = index.objects[found];
+
+        vector<unsigned char> data(object.size);
+        vector<size_t> offsets = extentOffsets(object);
+        parallelFor(object.extents.size(), [&](size_t i) {
+            const StoreExtent &extent = object.extents[i];
+            const StoreCover &cover = index.covers[extent.cover];
+            vector<unsigned char> payload;
+            StoreExtentHeader header;
+            if (!CoverSlot::read(cover, coverPath(extent.cover), EXTENT_MARKER, payload) ||
+                payload.size() != sizeof(header) + extent.length)
+            {
+                throw InvalidFormatException("Extent " + to_string(i) + " of " + name + " is missing from " +
+                                             cover.name);
+            }
+            memcpy(&header, payload.data(), sizeof(header));
+            if (header.magic != Config::STORE_EXTENT_MAGIC || header.objectId != object.id || header.index != i ||
+                header.length != extent.length ||
+                header.checksum != StoreIndex::checksum(payload.data() + sizeof(header), extent.length))
+            {
+                throw InvalidFormatException("Extent " + to_string(i) + " of " + name + " is corrupted in " +
+                                             cover.name);
+            }
+            memcpy(data.data() + offsets[i], payload.data() + sizeof(header), extent.length);
+        });
+        FileIOManager::writeFile(outputPath, data);
+
+        cout << "Retrieved " << name << " (" << Utils::formatBytes(data.size()) << ") to " << outputPath << endl;
+    }
+
+    void remove(const string &name)
+    {
+        int found = index.findObject(name);
+        if (found < 0)
+        {
+            throw FileAccessException("No object named " + name + " in " + directory);
+        }
+
+        vector<bool> used = usedCovers();
+        StoreObject object = index.objects[found];
+        index.objects.erase(index.objects.begin() + found);
+        vector<unsigned char> indexData;
+        int target = prepareIndex(indexData, used);
+        writeIndex(target, indexData);
+        scrub(object);
+
+        cout << "Deleted " << name << " (" << Utils::formatBytes(object.size) << ")" << endl;
+    }
+
+    void list(ostream &out) const
+    {
+        vector<bool> used = usedCovers();
+        uint64_t freeCapacity = 0;
+        size_t freeCovers = 0;
+        for (size_t c = 0; c < index.covers.size(); c++)
+        {
+            if (usable(c, used))
+            {
+                freeCapacity += index.covers[c].capacity - sizeof(StoreExtentHeader);
+                freeCovers++;
+            }
+        }
+
+        for (size_t i = 0; i < index.objects.size(); i++)
+        {
+            const StoreObject &object = index.objects[i];
+            out << object.name << "\t" << Utils::formatBytes(object.size) << "\t" << object.extents.size()
+                << " extent(s)" << endl;
+        }
+        out << index.objects.size() << " object(s); " << freeCovers << " of " << index.covers.size()
+            << " covers free (" << Utils::formatBytes(freeCapacity) << ")";
+        if (root >= 0)
+        {
+            out << "; index in " << index.covers[root].name;
+        }
+        out << endl;
+    }
+};
+
+const char *const ObjectStore::INDEX_MARKER = ".stego-index";
+const char *const ObjectStore::EXTENT_MARKER = ".stego-extent";
+
+// ============================================================================
+// DAEMON MODE
+// ============================================================================
+// Discards engine progress output for the lifetime of the object
+class QuietOutput
+{
+private:
+    streambuf *saved;
+
+public:
+    QuietOutput() : saved(cout.rdbuf(NULL)) {}
+
+    ~QuietOutput()
+    {
+        cout.rdbuf(saved);
+    }
+};
+
+// Runs jobs from stdin without a process start per job. One job per line,
+// fields separated by tabs:
+//   encode <cover> <secret> <output> [job-id [deadline-ms [fallback]]]
+//   decode <stego> <output> [job-id]
+// Each job is answered in order with "ok<TAB><written path>", followed by
+// "<TAB><trade-offs>" when an encode gave up effort for its deadline, or
+// "error<TAB><message>". The session ends at "quit" or end of input.
+class JobDaemon
+{
+private:
+    static vector<string> splitFields(const string &line)
+    {
+        vector<string> fields;
+        size_t start = 0;
+        while (true)
+        {
+            size_t tab = line.find('\t', start);
+            fields.push_back(line.substr(start, tab == string::npos ? string::npos : tab - start));
+            if (tab == string::npos)
+            {
+                return fields;
+            }
+            start = tab + 1;
+        }
+    }
+
+    // Every job gets its own id; jobs sent without one get a random id
+    // rather than the previous job's
+    static void setJobId(const vector<string> &fields, size_t index)
+    {
+        JobLog::setJobId(JobLog::makeJobId(fields.size() > index ? fields[index] : string()));
+    }
+
+    static string runJob(const vector<string> &fields)
+    {
+        const string &mode = fields[0];
+        if (mode == "encode" && fields.size() >= 4 && fields.size() <= 7)
+        {
+            setJobId(fields, 4);
+            UniversalSteganography stego(fields[2], fields[1], fields[3]);
+            if (fields.size() >= 6)
+            {
+                stego.setDeadline(fields[5]);
+            }
+            if (fields.size() == 7)
+            {
+                stego.setFallback(fields[6]);
+            }
+            string result = stego.hideFile();
+            if (!stego.tradeoffReport().empty())
+            {
+                result += "\t" + stego.tradeoffReport();
+            }
+            return result;
+        }
+        if (mode == "decode" && (fields.size() == 3 || fields.size() == 4))
+        {
+            setJobId(fields, 3);
+            UniversalSteganography stego("", fields[1], fields[2]);
+            return stego.extractFile();
+        }
+        throw SteganographyException("Invalid job: " + mode);
+    }
+
+public:
+    static int run(istream &in, ostream &out)
+    {
+        string line;
+        while (getline(in, line))
+        {
+            if (!line.empty() && line[line.size() - 1] == '\r')
+            {
+                line.erase(line.size() - 1);
+            }
+            if (line == "quit")
+            {
+                break;
+            }
+            if (line.empty())
+            {
+                continue;
+            }
+
+            string result;
+            string error;
+            try
+            {
+                QuietOutput quiet;
+                result = runJob(splitFields(line));
+            }
+            catch (const exception &e)
+            {
+                error = e.what();
+                replace(error.begin(), error.end(), '\n', ' ');
+            }
+
+            if (error.empty())
+                out << "ok\t" << result << '\n';
+            else
+                out << "error\t" << error << '\n';
+            out.flush();
+        }
+        return 0;
+    }
+};
+
+// ============================================================================
+// BENCHMARK SUITE
+// ============================================================================
+// Times whole jobs in-process, the way the daemon runs them, on synthetic
+// files in a scratch directory.
+class Benchmark
+{
+private:
+    struct Stats
+    {
+        double minUs;
+        double medianUs;
+        double p99Us;
+    };
+
+    static Stats measure(int iterations, const function<void()> &job)
+    {
+        QuietOutput quiet;
+        for (int i = 0; i < 5; i++)
+        {
+            job();
+        }
+
+        vector<double> samples;
+        samples.reserve(iterations);
+        for (int i = 0; i < iterations; i++)
+        {
+            chrono::steady_clock::time_point start = chrono::steady_clock::now();
+            job();
+            samples.push_back(chrono::duration<double, micro>(chrono::steady_clock::now() - start).count());
+        }
+        sort(samples.begin(), samples.end());
 
-        // Step 3: Validate size constraints
-        cout << "\n[3/5] Checking size constraints..." << endl;
-        size_t maxAllowed = FileValidator::validateAndCalculateMaxSize(hiddenSize, hostSize);
-        double utilizationPercent = (static_cast<double>(hiddenSize) / maxAllowed) * 100.0;
-        cout << "      ✓ Size check passed" << endl;
-        cout << "      • Capacity utilization: " << fixed << setprecision(1)
-             << utilizationPercent << "%" << endl;
-        cout << "      • Remaining capacity: "
-             << Utils::formatBytes(maxAllowed - hiddenSize) << "\n"
-             << endl;
+        Stats stats;
+        stats.minUs = samples.front();
+        stats.medianUs = samples[samples.size() / 2];
+        stats.p99Us = samples[min(samples.size() - 1, samples.size() * 99 / 100)];
+        return stats;
+    }
 
-        // Step 4: Read files
-        cout << "[4/5] Reading files..." << endl;
-        vector<unsigned char> hostData = FileIOManager::readFile(hostFilePath);
-        vector<unsigned char> hiddenData = FileIOManager::readFile(hiddenFilePath);
-        cout << "      ✓ Files loaded into memory\n"
-             << endl;
+    static void writeRandom(const string &filename, size_t size, mt19937 &rng)
+    {
+        vector<unsigned char> data(size);
+        for (size_t i = 0; i < size; i++)
+        {
+            data[i] = static_cast<unsigned char>(rng());
+        }
+        FileIOManager::writeFile(filename, data);
+    }
 
-        // Step 5: Create output with embedded data
-        cout << "[5/5] Embedding hidden file..." << endl;
-        StegoHeader header = createHeader(hiddenFilePath, hiddenSize);
-        vector<unsigned char> headerData = serializeHeader(header);
+    static void report(const string &payload, const string &name, const Stats &stats)
+    {
+        cout << left << setw(11) << payload << setw(30) << name << right
+             << fixed << setprecision(1)
+             << setw(10) << stats.minUs << " us"
+             << setw(10) << stats.medianUs << " us"
+             << setw(10) << stats.p99Us << " us" << endl;
+    }
 
-        // Construct output: host + header + hidden
-        vector<unsigned char> output;
-        output.reserve(hostData.size() + headerData.size() + hiddenData.size());
+    static void put16(vector<unsigned char> &out, uint16_t value)
+    {
+        out.push_back(static_cast<unsigned char>(value));
+        out.push_back(static_cast<unsigned char>(value >> 8));
+    }
 
-        output.insert(output.end(), hostData.begin(), hostData.end());
-        output.insert(output.end(), headerData.begin(), headerData.end());
-        output.insert(output.end(), hiddenData.begin(), hiddenData.end());
+    static void put32(vector<unsigned char> &out, uint32_t value)
+    {
+        put16(out, static_cast<uint16_t>(value));
+        put16(out, static_cast<uint16_t>(value >> 16));
+    }
 
-        // Ensure output file has same extension as cover/host file
-        string finalOutputPath = Utils::generateOutputFilename(outputFilePath, Utils::extractFilename(hostFilePath));
+    static void putBE32(unsigned char *p, uint32_t value)
+    {
+        p[0] = static_cast<unsigned char>(value >> 24);
+        p[1] = static_cast<unsigned char>(value >> 16);
+        p[2] = static_cast<unsigned char>(value >> 8);
+        p[3] = static_cast<unsigned char>(value);
+    }
 
-        // Write output
-        FileIOManager::writeFile(finalOutputPath, output);
+    // Noisy RGB image of roughly `size` encoded bytes
+    static void writeQoiCover(const string &filename, size_t size, mt19937 &rng)
+    {
+        QoiImageInfo info;
+        info.width = 512;
+        info.height = static_cast<uint32_t>(max<size_t>(1, size / (512 * 4)));
+        info.channels = 3;
+        info.colorspace = 0;
 
-        cout << "      ✓ File embedded successfully" << endl;
-        cout << "\n━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━" << endl;
-        cout << "  ✓ OPERATION COMPLETED SUCCESSFULLY" << endl;
-        cout << "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n"
-             << endl;
-        cout << "Output file: " << finalOutputPath << endl;
-        cout << "Total size: " << Utils::formatBytes(output.size()) << endl;
-        cout << "Hidden file: " << header.filename << " ("
-             << Utils::formatBytes(hiddenSize) << ")" << endl;
+        ofstream out(filename, ios::binary);
+        QoiEncoder::writeHeader(out, info);
+        QoiEncoder encoder(out);
+        QoiPixel px;
+        px.a = 255;
+        for (uint64_t i = 0; i < info.pixelCount(); i++)
+        {
+            uint32_t noise = rng();
+            px.r = static_cast<unsigned char>(noise);
+            px.g = static_cast<unsigned char>(noise >> 8);
+            px.b = static_cast<unsigned char>(noise >> 16);
+            encoder.put(px);
+        }
+        encoder.finish();
     }
 
-    void extractFile()
+    // Single-strip little endian float32 TIFF
+    static void writeFloatCover(const string &filename, size_t size, mt19937 &rng)
     {
-        cout << "\n━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━" << endl;
-        cout << "  INITIATING FILE EXTRACTION PROCESS" << endl;
-        cout << "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n"
-             << endl;
+        uint32_t width = 1024;
+        uint32_t height = static_cast<uint32_t>(max<size_t>(1, size / (width * 4)));
+        uint32_t dataBytes = width * height * 4;
 
-        // Step 1: Validate file access
-        cout << "[1/4] Validating file access..." << endl;
-        FileValidator::validateFileAccess(hostFilePath, "Stego file");
-        cout << "      ✓ File validated\n"
-             << endl;
+        vector<unsigned char> d;
+        d.push_back('I');
+        d.push_back('I');
+        put16(d, 42);
+        put32(d, 8 + dataBytes);
+        uniform_real_distribution<float> sample(0.01f, 100.0f);
+        for (uint32_t i = 0; i < width * height; i++)
+        {
+            float value = sample(rng);
+            uint32_t bits;
+            memcpy(&bits, &value, sizeof(bits));
+            put32(d, bits);
+        }
 
-        // Step 2: Read file
-        cout << "[2/4] Reading stego file..." << endl;
-        vector<unsigned char> data = FileIOManager::readFile(hostFilePath);
-        size_t fileSize = data.size();
-        cout << "      • File size: " << Utils::formatBytes(fileSize) << "\n"
-             << endl;
+        const uint32_t entries[][3] = {{256, 4, width}, {257, 4, height}, {258, 3, 32}, {259, 3, 1},
+                                       {262, 3, 1}, {273, 4, 8}, {277, 3, 1}, {278, 4, height},
+                                       {279, 4, dataBytes}, {339, 3, 3}};
+        size_t count = sizeof(entries) / sizeof(entries[0]);
+        put16(d, static_cast<uint16_t>(count));
+        for (size_t i = 0; i < count; i++)
+        {
+            put16(d, static_cast<uint16_t>(entries[i][0]));
+            put16(d, static_cast<uint16_t>(entries[i][1]));
+            put32(d, 1);
+            put32(d, entries[i][2]);
+        }
+        put32(d, 0);
+        FileIOManager::writeFile(filename, d);
+    }
 
-        // Step 3: Extract and validate header
-        cout << "[3/4] Searching for hidden data..." << endl;
-        if (data.size() < sizeof(StegoHeader))
+    // Explicit VR little endian DICOM with one 12-bit frame
+    static void writeDicomCover(const string &filename, size_t size, mt19937 &rng)
+    {
+        uint16_t columns = 512;
+        uint16_t rows = static_cast<uint16_t>(min<size_t>(65535, max<size_t>(1, size / (columns * 2))));
+        vector<unsigned char> d(Config::DICOM_PREAMBLE_SIZE, 0);
+        const char *prefix = "DICM";
+        d.insert(d.end(), prefix, prefix + 4);
+
+        const char syntax[] = "1.2.840.10008.1.2.1"; // 19 chars + NUL pad
+        put16(d, 0x0002);
+        put16(d, 0x0000);
+        d.push_back('U');
+        d.push_back('L');
+        put16(d, 4);
+        put32(d, 8 + 20);
+        put16(d, 0x0002);
+        put16(d, 0x0010);
+        d.push_back('U');
+        d.push_back('I');
+        put16(d, 20);
+        d.insert(d.end(), syntax, syntax + 20);
+
+        const uint16_t attributes[][2] = {{0x0002, 1}, {0x0010, rows}, {0x0011, columns},
+                                          {0x0100, 16}, {0x0101, 12}, {0x0102, 11}};
+        for (size_t i = 0; i < sizeof(attributes) / sizeof(attributes[0]); i++)
         {
-            throw InvalidFormatException("File too small to contain hidden data");
+            put16(d, 0x0028);
+            put16(d, attributes[i][0]);
+            d.push_back('U');
+            d.push_back('S');
+            put16(d, 2);
+            put16(d, attributes[i][1]);
+        }
+
+        uint32_t pixelBytes = uint32_t(rows) * columns * 2;
+        put16(d, 0x7FE0);
+        put16(d, 0x0010);
+        d.push_back('O');
+        d.push_back('W');
+        put16(d, 0);
+        put32(d, pixelBytes);
+        for (uint32_t i = 0; i < pixelBytes / 2; i++)
+        {
+            put16(d, static_cast<uint16_t>(rng() & 0x0FFF));
         }
+        FileIOManager::writeFile(filename, d);
+    }
+
+    // Empty 4 KB-page database whose pages 2.. are all on the freelist
+    static void writeSqliteCover(const string &filename, size_t size)
+    {
+        const uint32_t pageSize = 4096;
+        uint32_t pages = static_cast<uint32_t>(max<size_t>(3, size / pageSize));
+        vector<unsigned char> d(size_t(pages) * pageSize, 0);
 
-        // Header is located after original host file data
-        size_t headerOffset = data.size() - sizeof(StegoHeader);
+        unsigned char *h = d.data();
+        memcpy(h, "SQLite format 3\0", 16);
+        h[16] = pageSize >> 8;
+        h[17] = pageSize & 0xFF;
+        h[18] = h[19] = 1;
+        h[21] = 64;
+        h[22] = h[23] = 32;
+        putBE32(h + 24, 1);
+        putBE32(h + 28, pages);
+        putBE32(h + 32, 2);
+        putBE32(h + 36, pages - 1);
+        putBE32(h + 44, 4);
+        putBE32(h + 56, 1);
+        putBE32(h + 92, 1);
+        putBE32(h + 96, 3045000);
+        h[100] = 0x0D; // empty sqlite_schema leaf table
+        h[105] = pageSize >> 8;
+        h[106] = pageSize & 0xFF;
 
-        // Search backwards for header signature
-        bool found = false;
-        for (size_t i = data.size() - sizeof(StegoHeader); i > 0; i--)
+        // Trunks each list up to usable/4 - 2 leaves that directly follow them
+        uint32_t perTrunk = pageSize / 4 - 2;
+        for (uint32_t trunk = 2; trunk <= pages;)
+        {
+            uint32_t leaves = min(perTrunk, pages - trunk);
+            uint32_t next = trunk + leaves + 1;
+            unsigned char *p = d.data() + size_t(trunk - 1) * pageSize;
+            putBE32(p, next <= pages ? next : 0);
+            putBE32(p + 4, leaves);
+            for (uint32_t i = 0; i < leaves; i++)
+            {
+                putBE32(p + 8 + 4 * i, trunk + 1 + i);
+            }
+            trunk = next;
+        }
+        FileIOManager::writeFile(filename, d);
+    }
+
+    static void writeCover(HostFormat format, const string &filename, size_t size, mt19937 &rng)
+    {
+        switch (format)
         {
-            vector<unsigned char> potentialHeader(data.begin() + i,
-                                                  data.begin() + i + sizeof(StegoHeader));
-            StegoHeader header = deserializeHeader(potentialHeader);
+        case HOST_QOI:
+            writeQoiCover(filename, size, rng);
+            break;
+        case HOST_FLOAT_IMAGE:
+            writeFloatCover(filename, size, rng);
+            break;
+        case HOST_DICOM:
+            writeDicomCover(filename, size, rng);
+            break;
+        case HOST_SQLITE:
+            writeSqliteCover(filename, size);
+            break;
+        default:
+            writeRandom(filename, size, rng);
+            break;
+        }
+    }
+
+    // Fits the cost model from three points per format: a small and a large
+    // cover with a small payload, and the small cover with a larger payload
+    static int calibrate(const string &directory, const string &modelPath)
+    {
+        Utils::ensureDirectory(directory);
+        string smallCover = directory + "/cover-small";
+        string largeCover = directory + "/cover-large";
+        string smallSecret = directory + "/secret-small.dat";
+        string largeSecret = directory + "/secret-large.dat";
+        string output = directory + "/stego";
+
+        mt19937 rng(20240601);
+        writeRandom(smallSecret, Config::CALIBRATION_SMALL_PAYLOAD, rng);
+        writeRandom(largeSecret, Config::CALIBRATION_LARGE_PAYLOAD, rng);
 
-            if (header.magic == Config::MAGIC_SIGNATURE && header.validate())
+        CostModel &model = CostModel::instance();
+        cout << "Calibrating cost model: " << Config::CALIBRATION_ITERATIONS << " iterations per point" << endl;
+        cout << left << setw(8) << "Format" << right << setw(14) << "fixed us" << setw(16) << "ns/cover byte"
+             << setw(17) << "ns/stream byte" << endl;
+        for (int f = 0; f < HOST_FORMAT_COUNT; f++)
+        {
+            HostFormat format = static_cast<HostFormat>(f);
+            writeCover(format, smallCover, Config::CALIBRATION_SMALL_COVER, rng);
+            writeCover(format, largeCover, Config::BENCH_COVER_SIZE, rng);
+            if (HostDetector::detect(smallCover) != format || HostDetector::detect(largeCover) != format)
             {
-                headerOffset = i;
-                found = true;
-                break;
+                throw SteganographyException(string("Calibration cover not recognised as ") + HostDetector::name(format));
             }
+
+            double s1 = static_cast<double>(Utils::getFileSize(smallCover));
+            double s2 = static_cast<double>(Utils::getFileSize(largeCover));
+            double p1 = static_cast<double>(Config::CALIBRATION_SMALL_PAYLOAD);
+            double p2 = static_cast<double>(Config::CALIBRATION_LARGE_PAYLOAD);
+            double t1 = timeEncode(smallCover, smallSecret, output);
+            double t2 = timeEncode(largeCover, smallSecret, output);
+            double t3 = timeEncode(smallCover, largeSecret, output);
+
+            CostCoefficients c;
+            c.nsPerCoverByte = max(0.0, (t2 - t1) * 1000.0 / (s2 - s1));
+            c.nsPerStreamByte = max(0.0, (t3 - t1) * 1000.0 / (p2 - p1));
+            c.fixedUs = max(0.0, t1 - (c.nsPerCoverByte * s1 + c.nsPerStreamByte * p1) / 1000.0);
+            model.set(format, c);
+            cout << left << setw(8) << HostDetector::key(format) << right << fixed << setprecision(1)
+                 << setw(14) << c.fixedUs << setprecision(3) << setw(16) << c.nsPerCoverByte
+                 << setw(17) << c.nsPerStreamByte << endl;
         }
 
-        if (!found)
+        model.save(modelPath);
+        cout << "Cost model written to " << modelPath << endl;
+
+        remove(smallCover.c_str());
+        remove(largeCover.c_str());
+        remove(smallSecret.c_str());
+        remove(largeSecret.c_str());
+        remove(output.c_str());
+        remove(directory.c_str());
+        return 0;
+    }
+
+    static double timeEncode(const string &cover, const string &secret, const string &output)
+    {
+        return measure(Config::CALIBRATION_ITERATIONS, [&]() {
+                   UniversalSteganography stego(secret, cover, output);
+                   stego.setFastPath(false);
+                   stego.hideFile();
+               })
+            .medianUs;
+    }
+
+public:
+    static int run(int iterations, const string &directory, const string &calibrationPath)
+    {
+        if (!calibrationPath.empty())
         {
-            throw InvalidFormatException("No hidden data found in file");
+            return calibrate(directory, calibrationPath);
+        }
+        if (iterations <= 0)
+        {
+            throw SteganographyException("Iteration count must be positive");
         }
+        Utils::ensureDirectory(directory);
+        string cover = directory + "/cover.bin";
+        string secret = directory + "/secret.dat";
+        string output = directory + "/stego.bin";
+        string extractTo = directory + "/extracted";
+
+        mt19937 rng(20240601);
+        writeRandom(cover, Config::BENCH_COVER_SIZE, rng);
 
-        vector<unsigned char> headerData(data.begin() + headerOffset,
-                                         data.begin() + headerOffset + sizeof(StegoHeader));
-        StegoHeader header = deserializeHeader(headerData);
+        cout << "Benchmark: " << iterations << " iterations per case, "
+             << Utils::formatBytes(Config::BENCH_COVER_SIZE) << " cover" << endl;
+        cout << left << setw(11) << "Payload" << setw(30) << "Case" << right
+             << setw(13) << "min" << setw(13) << "median" << setw(13) << "p99" << endl;
 
-        if (!header.validate())
+        // Floor for every append-format encode: without reflink support the
+        // kernel still copies the whole cover
+        FileIOManager::CopyMethod method = FileIOManager::COPY_STREAM;
+        Stats copy = measure(iterations, [&]() { method = FileIOManager::cloneFile(cover, output); });
+        report("-", string("host copy (") + FileIOManager::copyMethodName(method) + ")", copy);
+
+        // Tile kernels of the pixel engines over one cover's worth of bytes:
+        // split into planes, set the carrier bits, merge back
+        vector<unsigned char> pixels(Config::BENCH_COVER_SIZE);
+        for (size_t i = 0; i < pixels.size(); i++)
+        {
+            pixels[i] = static_cast<unsigned char>(rng());
+        }
+        vector<unsigned char> planeA(Config::QOI_TILE_PIXELS * 3);
+        vector<unsigned char> planeB(Config::QOI_TILE_PIXELS * 3);
+        vector<unsigned char> bits(Config::QOI_TILE_PIXELS);
+        FloatRegion floatRegion = {0, pixels.size() / 4, 32, false};
+        vector<FloatRegion> floatRegions(1, floatRegion);
+        vector<unsigned char> floatStream(pixels.size() / 4 * Config::FLOAT32_EMBED_BITS / 16);
+        for (int level = ChannelPlanes::LEVEL_SCALAR; level <= ChannelPlanes::detected(); level++)
         {
-            throw InvalidFormatException("Invalid or corrupted header");
+            ChannelPlanes::setLevel(static_cast<ChannelPlanes::Level>(level));
+            string suffix = string(" (") + ChannelPlanes::levelName(ChannelPlanes::level()) + ")";
+            report("-", "RGBA tiles" + suffix, measure(iterations, [&]() {
+                       const size_t tile = Config::QOI_TILE_PIXELS;
+                       for (size_t i = 0; i + tile * 4 <= pixels.size(); i += tile * 4)
+                       {
+                           ChannelPlanes::splitAlpha(pixels.data() + i, tile, planeA.data(), planeB.data());
+                           ChannelPlanes::scatterBits(bits.data(), tile * 3 / 8, 0, planeA.data());
+                           ChannelPlanes::mergeAlpha(planeA.data(), planeB.data(), tile, pixels.data() + i);
+                       }
+                   }));
+            report("-", "16-bit tiles" + suffix, measure(iterations, [&]() {
+                       const size_t tile = Config::DICOM_TILE_SAMPLES;
+                       for (size_t i = 0; i + tile * 2 <= pixels.size(); i += tile * 2)
+                       {
+                           ChannelPlanes::split16(pixels.data() + i, tile, planeA.data(), planeB.data());
+                           ChannelPlanes::scatterBits(bits.data(), tile / 8, 0, planeA.data());
+                           ChannelPlanes::merge16(planeA.data(), planeB.data(), tile, pixels.data() + i);
+                       }
+                   }));
+            report(Utils::formatBytes(floatStream.size()), "float32 blocks" + suffix, measure(iterations, [&]() {
+                       FloatImageEngine::embed(pixels, floatRegions, floatStream);
+                   }));
         }
+        ChannelPlanes::setLevel(ChannelPlanes::detected());
 
-        cout << "      ✓ Hidden data located" << endl;
-        cout << "      • Original filename: " << header.filename << endl;
-        cout << "      • Hidden file size: "
-             << Utils::formatBytes(header.hiddenFileSize) << "\n"
-             << endl;
+        // SHA-256 of one cover's worth of bytes as a single message, and as a
+        // verify batch of small payloads
+        const size_t smallPayload = 256;
+        vector<const unsigned char *> messages;
+        vector<size_t> lengths;
+        for (size_t i = 0; i + smallPayload <= pixels.size(); i += smallPayload)
+        {
+            messages.push_back(pixels.data() + i);
+            lengths.push_back(smallPayload);
+        }
+        vector<unsigned char> digests(messages.size() * Sha256::DIGEST_SIZE);
+        const char *hashPaths[] = {"portable", "SHA-NI", "AVX2 x8"};
+        const bool hashPathAvailable[] = {true, Sha256::hasShaNi(), Sha256::hasMultiBuffer()};
+        for (int path = 0; path < 3; path++)
+        {
+            if (!hashPathAvailable[path])
+            {
+                continue;
+            }
+            Sha256::setAcceleration(path == 1, path == 2);
+            string suffix = string(" (") + hashPaths[path] + ")";
+            if (path != 2)
+            {
+                report("-", "SHA-256" + suffix, measure(iterations, [&]() {
+                           Sha256::hash(pixels.data(), pixels.size(), digests.data());
+                       }));
+            }
+            report(Utils::formatBytes(smallPayload), "SHA-256 batch" + suffix, measure(iterations, [&]() {
+                       Sha256::hashMany(messages, lengths, digests.data());
+                   }));
+        }
+        Sha256::setAcceleration(true, true);
+        report(Utils::formatBytes(smallPayload), "SHA-256 batch (auto)", measure(iterations, [&]() {
+                   Sha256::hashMany(messages, lengths, digests.data());
+               }));
 
-        // Step 4: Extract hidden data
-        cout << "[4/4] Extracting hidden file..." << endl;
-        size_t hiddenDataOffset = headerOffset + sizeof(StegoHeader);
+        const size_t payloads[] = {1024, 4096, Config::FAST_PATH_MAX_PAYLOAD};
+        string extracted;
+        for (size_t p = 0; p < sizeof(payloads) / sizeof(payloads[0]); p++)
+        {
+            writeRandom(secret, payloads[p], rng);
 
-        if (hiddenDataOffset + header.hiddenFileSize > data.size())
+            report(Utils::formatBytes(payloads[p]), "encode (fast path)", measure(iterations, [&]() {
+                       UniversalSteganography stego(secret, cover, output);
+                       stego.hideFile();
+                   }));
+            report(Utils::formatBytes(payloads[p]), "encode (general)", measure(iterations, [&]() {
+                       UniversalSteganography stego(secret, cover, output);
+                       stego.setFastPath(false);
+                       stego.hideFile();
+                   }));
+            report(Utils::formatBytes(payloads[p]), "decode", measure(iterations, [&]() {
+                       UniversalSteganography stego("", output, extractTo);
+                       extracted = stego.extractFile();
+                   }));
+        }
+
+        // On a small cover the host copy no longer dominates, so the fixed
+        // per-encode cost of the two paths shows up directly
+        string smallCover = directory + "/small-cover.bin";
+        writeRandom(smallCover, Config::BENCH_SMALL_COVER_SIZE, rng);
+        string smallLabel = " (" + Utils::formatBytes(Config::BENCH_SMALL_COVER_SIZE) + " cover)";
+        for (size_t p = 0; p < sizeof(payloads) / sizeof(payloads[0]); p++)
         {
-            throw InvalidFormatException("Corrupted file: size mismatch");
+            if (payloads[p] > Config::BENCH_SMALL_COVER_SIZE / 2)
+            {
+                continue;
+            }
+            writeRandom(secret, payloads[p], rng);
+
+            report(Utils::formatBytes(payloads[p]), "fast path" + smallLabel, measure(iterations, [&]() {
+                       UniversalSteganography stego(secret, smallCover, output);
+                       stego.hideFile();
+                   }));
+            report(Utils::formatBytes(payloads[p]), "general" + smallLabel, measure(iterations, [&]() {
+                       UniversalSteganography stego(secret, smallCover, output);
+                       stego.setFastPath(false);
+                       stego.hideFile();
+                   }));
         }
 
-        vector<unsigned char> hiddenData(data.begin() + hiddenDataOffset,
-                                         data.begin() + hiddenDataOffset + header.hiddenFileSize);
+        remove(smallCover.c_str());
+        remove(cover.c_str());
+        remove(secret.c_str());
+        remove(output.c_str());
+        remove(extracted.c_str());
+        remove(directory.c_str());
+        return 0;
+    }
+};
 
-        // Generate output filename with proper extension preservation
-        string extractedFilename = Utils::generateOutputFilename(outputFilePath, header.filename);
+// ============================================================================
+// SELF TEST
+// ============================================================================
+// Known-answer tests for the signature code (RFC 8032, section 7.1). Each
+// vector must derive the published key and signature and verify on both the
+// single and the batch path; a tampered copy must fail on both. The QOI
+// checks decode every op kind and reject pixel data cut off mid-op.
+class SelfTest
+{
+private:
+    struct Ed25519Vector
+    {
+        const char *secretKey;
+        const char *publicKey;
+        const char *message;
+        const char *signature;
+    };
 
-        FileIOManager::writeFile(extractedFilename, hiddenData);
+    static bool check(const string &name, bool passed, size_t &failures)
+    {
+        cout << (passed ? "ok      " : "FAILED  ") << name << endl;
+        failures += passed ? 0 : 1;
+        return passed;
+    }
 
-        cout << "      ✓ File extracted successfully" << endl;
-        cout << "\n━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━" << endl;
-        cout << "  ✓ EXTRACTION COMPLETED SUCCESSFULLY" << endl;
-        cout << "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n"
-             << endl;
-        cout << "Extracted file: " << extractedFilename << endl;
-        cout << "File size: " << Utils::formatBytes(hiddenData.size()) << endl;
+    // Decodes QOI pixel data (no header) of a width x 1 image; false when
+    // the decoder rejects it
+    static bool decodeQoi(const string &data, uint32_t width, vector<QoiPixel> &pixels)
+    {
+        istringstream in(data);
+        QoiImageInfo info;
+        info.width = width;
+        info.height = 1;
+        info.channels = 4;
+        info.colorspace = 0;
+        QoiDecoder decoder(in, info);
+        pixels.assign(width, QoiPixel());
+        try
+        {
+            return decoder.nextTile(pixels.data(), pixels.size()) == pixels.size();
+        }
+        catch (const InvalidFormatException &)
+        {
+            return false;
+        }
+    }
+
+    static bool samePixel(const QoiPixel &px, int r, int g, int b, int a)
+    {
+        return px.r == r && px.g == g && px.b == b && px.a == a;
+    }
+
+    static void runQoi(size_t &failures)
+    {
+        // RGB, DIFF, LUMA, RUN of 2, RGBA, INDEX of the first pixel
+        const string ops("\xfe\x0a\x14\x1e\x79\xa2\x97\xc1\xff\x01\x02\x03\x04\x09", 14);
+        vector<QoiPixel> px;
+        bool decoded = decodeQoi(ops, 7, px);
+        check("QOI: every op kind decodes",
+              decoded && samePixel(px[0], 10, 20, 30, 255) && samePixel(px[1], 11, 20, 29, 255) &&
+                  samePixel(px[2], 14, 22, 30, 255) && samePixel(px[3], 14, 22, 30, 255) &&
+                  samePixel(px[4], 14, 22, 30, 255) && samePixel(px[5], 1, 2, 3, 4) &&
+                  samePixel(px[6], 10, 20, 30, 255),
+              failures);
+
+        // Each op cut off at the end of the input, in a 1000x1000 image
+        static const char *const names[] = {"no pixel data", "RGBA op with 0 of 4 bytes", "RGB op with 2 of 3 bytes",
+                                            "RGBA op with 3 of 4 bytes", "LUMA op with 0 of 1 bytes"};
+        const string truncated[] = {string(), string("\xff", 1), string("\xfe\x01\x02", 3),
+                                    string("\xff\x01\x02\x03", 4), string("\xa2", 1)};
+        for (size_t i = 0; i < sizeof(truncated) / sizeof(truncated[0]); i++)
+        {
+            check(string("QOI: truncated cover rejected (") + names[i] + ")",
+                  !decodeQoi(truncated[i], 1000000, px), failures);
+        }
+    }
+
+public:
+    static int run()
+    {
+        static const Ed25519Vector vectors[] = {
+            {"9d61b19deffd5a60ba844af492ec2cc44449c5697b326919703bac031cae7f60",
+             "d75a980182b10ab7d54bfed3c964073a0ee172f3daa62325af021a68f707511a", "",
+             "e5564300c360ac729086e2cc806e828a84877f1eb8e5d974d873e06522490155"
+             "5fb8821590a33bacc61e39701cf9b46bd25bf5f0595bbe24655141438e7a100b"},
+            {"4ccd089b28ff96da9db6c346ec114e0f5b8a319f35aba624da8cf6ed4fb8a6fb",
+             "3d4017c3e843895a92b70aa74d1b7ebc9c982ccf2ec4968cc0cd55f12af4660c", "72",
+             "92a009a9f0d4cab8720e820b5f642540a2b27b5416503f8fb3762223ebdb69da"
+             "085ac1e43e15996e458f3613d0f11d8c387b2eaeb4302aeeb00d291612bb0c00"},
+            {"c5aa8df43f9f837bedb7442f31dcb7b166d38535076f094b85ce3a2e0b4458f7",
+             "fc51cd8e6218a1a38da47ed00230f0580816ed13ba3303ac5deb911548908025", "af82",
+             "6291d657deec24024827e69c3abe01a30ce548a284743a445e3680d7db5ac3ac"
+             "18ff9b538d16f290ae67f760984dc6594a7c15e9716ed28dc027beceea1ec40a"}};
+        const size_t count = sizeof(vectors) / sizeof(vectors[0]);
+
+        size_t failures = 0;
+        vector<vector<unsigned char> > publicKeys(count), messages(count), signatures(count);
+        vector<unsigned char> tampered;
+        for (size_t i = 0; i < count; i++)
+        {
+            string name = "RFC 8032 test " + to_string(i + 1);
+            vector<unsigned char> secretKey = Utils::fromHex(vectors[i].secretKey);
+            secretKey.resize(Ed25519::SECRET_KEY_SIZE);
+            Ed25519::derivePublicKey(secretKey.data());
+            publicKeys[i] = Utils::fromHex(vectors[i].publicKey);
+            messages[i] = Utils::fromHex(vectors[i].message);
+            signatures[i] = Utils::fromHex(vectors[i].signature);
+            check(name + ": public key", memcmp(secretKey.data() + 32, publicKeys[i].data(), 32) == 0, failures);
+
+            unsigned char signature[Ed25519::SIGNATURE_SIZE];
+            Ed25519::sign(signature, messages[i].data(), messages[i].size(), secretKey.data());
+            check(name + ": signature", memcmp(signature, signatures[i].data(), sizeof(signature)) == 0, failures);
+            check(name + ": verify", Ed25519::verify(signatures[i].data(), messages[i].data(), messages[i].size(),
+                                                     publicKeys[i].data()),
+                  failures);
+
+            tampered = signatures[i];
+            tampered[40] ^= 1;
+            check(name + ": tampered signature rejected",
+                  !Ed25519::verify(tampered.data(), messages[i].data(), messages[i].size(), publicKeys[i].data()),
+                  failures);
+        }
+
+        // The batch path must agree with the single path entry by entry,
+        // including when one bad signature sits among good ones
+        vector<Ed25519::BatchEntry> entries;
+        for (size_t round = 0; round < 3; round++)
+        {
+            for (size_t i = 0; i < count; i++)
+            {
+                Ed25519::BatchEntry entry;
+                entry.publicKey = publicKeys[i].data();
+                entry.signature = signatures[i].data();
+                entry.message = messages[i].data();
+                entry.messageLength = messages[i].size();
+                entries.push_back(entry);
+            }
+        }
+        vector<bool> valid;
+        check("batch of valid signatures", Ed25519::verifyEach(entries, valid), failures);
+
+        tampered = signatures[1];
+        tampered[40] ^= 1;
+        entries[4].signature = tampered.data();
+        bool batchValid = Ed25519::verifyEach(entries, valid);
+        bool agrees = !batchValid;
+        for (size_t i = 0; i < entries.size(); i++)
+        {
+            const Ed25519::BatchEntry &e = entries[i];
+            agrees = agrees && valid[i] == Ed25519::verify(e.signature, e.message, e.messageLength, e.publicKey) &&
+                     valid[i] == (i != 4);
+        }
+        check("batch with one tampered signature", agrees, failures);
+
+        runQoi(failures);
+
+        cout << "\nChecks failed: " << failures << endl;
+        return failures == 0 ? 0 : 1;
     }
 };
 
@@ -502,6 +7836,46 @@ void printUsage()
     cout << "Usage:" << endl;
     cout << "  Encode: stego encode <cover_image> <secret_file> <output_image>" << endl;
     cout << "  Decode: stego decode <stego_image> <output_file>" << endl;
+    cout << "  Keygen: stego keygen <key_prefix>" << endl;
+    cout << "  Verify: stego verify [--pubkey <key.pub>] <stego_file>..." << endl;
+    cout << "  Scan:   stego scan [--pubkey <key.pub>] <file>..." << endl;
+    cout << "  Info:   stego info [--pubkey <key.pub>] <file>..." << endl;
+    cout << "  Log:    stego logdump <stego-jobs.bin>...    (prints JSONL)" << endl;
+    cout << "  Daemon: stego daemon                         (jobs on stdin, one per line)" << endl;
+    cout << "  Test:   stego selftest                       (signature and QOI decoder checks)" << endl;
+    cout << "  Bench:  stego bench [--iterations <n>] [--dir <scratch_dir>] [--calibrate <cost_model>]" << endl;
+    cout << "  Store:  stego store put <cover_dir> <file> [name]" << endl;
+    cout << "          stego store get <cover_dir> <name> <output_file>" << endl;
+    cout << "          stego store delete <cover_dir> <name>" << endl;
+    cout << "          stego store list <cover_dir>" << endl;
+    cout << "Options:" << endl;
+    cout << "  encode --sign <key.key>   Sign the payload with an Ed25519 key" << endl;
+    cout << "  encode --deadline-ms <n>  Fail when the embedding is estimated over a time budget" << endl;
+    cout << "  encode --fallback append  Use plain append instead of failing a deadline" << endl;
+    cout << "  --cost-model <file>       Cost model written by bench --calibrate" << endl;
+    cout << "  --joblog <dir>            Append binary job events to <dir>/stego-jobs.bin" << endl;
+    cout << "  --job-id <hex>            Job id recorded in the job log" << endl;
+}
+
+// Splits "--name value" options from positional arguments
+void parseArguments(int argc, char *argv[], vector<string> &positional, map<string, string> &options)
+{
+    for (int i = 2; i < argc; i++)
+    {
+        string arg = argv[i];
+        if (arg.size() > 2 && arg.compare(0, 2, "--") == 0)
+        {
+            if (i + 1 >= argc)
+            {
+                throw SteganographyException("Missing value for option " + arg);
+            }
+            options[arg.substr(2)] = argv[++i];
+        }
+        else
+        {
+            positional.push_back(arg);
+        }
+    }
 }
 
 int main(int argc, char *argv[])
@@ -515,41 +7889,142 @@ int main(int argc, char *argv[])
         }
 
         string mode = argv[1];
+        vector<string> args;
+        map<string, string> options;
+        parseArguments(argc, argv, args, options);
+        JobLogSession jobLog(options["joblog"], options["job-id"]);
+        if (options.count("cost-model"))
+        {
+            CostModel::instance().load(options["cost-model"]);
+        }
 
         if (mode == "encode")
         {
-            if (argc != 5)
+            if (args.size() != 3)
             {
                 cerr << "ERROR: Encode requires 3 arguments" << endl;
                 printUsage();
                 return 1;
             }
 
-            string coverImage = argv[2];
-            string secretFile = argv[3];
-            string outputImage = argv[4];
+            string coverImage = args[0];
+            string secretFile = args[1];
+            string outputImage = args[2];
 
             UniversalSteganography stego(secretFile, coverImage, outputImage);
+            if (options.count("sign"))
+            {
+                stego.setSigningKey(options["sign"]);
+            }
+            if (options.count("deadline-ms"))
+            {
+                stego.setDeadline(options["deadline-ms"]);
+            }
+            if (options.count("fallback"))
+            {
+                stego.setFallback(options["fallback"]);
+            }
             stego.hideFile();
         }
         else if (mode == "decode")
         {
-            if (argc != 4)
+            if (args.size() != 2)
             {
                 cerr << "ERROR: Decode requires 2 arguments" << endl;
                 printUsage();
                 return 1;
             }
 
-            string stegoImage = argv[2];
-            string outputFile = argv[3];
+            string stegoImage = args[0];
+            string outputFile = args[1];
 
             UniversalSteganography stego("", stegoImage, outputFile);
             stego.extractFile();
         }
+        else if (mode == "keygen")
+        {
+            if (args.size() != 1)
+            {
+                cerr << "ERROR: Keygen requires 1 argument" << endl;
+                printUsage();
+                return 1;
+            }
+
+            PayloadSigner::generateKeyPair(args[0]);
+        }
+        else if (mode == "verify" || mode == "scan" || mode == "info")
+        {
+            if (args.empty())
+            {
+                cerr << "ERROR: " << mode << " requires at least one file" << endl;
+                printUsage();
+                return 1;
+            }
+
+            PayloadVerifier::Mode reportMode = mode == "scan"   ? PayloadVerifier::MODE_SCAN
+                                               : mode == "info" ? PayloadVerifier::MODE_INFO
+                                                                : PayloadVerifier::MODE_VERIFY;
+            return PayloadVerifier::run(args, options["pubkey"], reportMode);
+        }
+        else if (mode == "logdump")
+        {
+            if (args.empty())
+            {
+                cerr << "ERROR: logdump requires at least one log file" << endl;
+                printUsage();
+                return 1;
+            }
+
+            for (size_t i = 0; i < args.size(); i++)
+            {
+                JobLog::dump(args[i], cout);
+            }
+        }
+        else if (mode == "daemon")
+        {
+            return JobDaemon::run(cin, cout);
+        }
+        else if (mode == "bench")
+        {
+            int iterations = options.count("iterations") ? atoi(options["iterations"].c_str())
+                                                         : Config::BENCH_ITERATIONS;
+            return Benchmark::run(iterations, options.count("dir") ? options["dir"] : "stego-bench",
+                                  options["calibrate"]);
+        }
+        else if (mode == "selftest")
+        {
+            return SelfTest::run();
+        }
+        else if (mode == "store")
+        {
+            string command = args.empty() ? "" : args[0];
+            if (command == "put" && (args.size() == 3 || args.size() == 4))
+            {
+                ObjectStore(args[1]).put(args[2], args.size() == 4 ? args[3] : Utils::extractFilename(args[2]));
+            }
+            else if (command == "get" && args.size() == 4)
+            {
+                ObjectStore(args[1]).get(args[2], args[3]);
+            }
+            else if (command == "delete" && args.size() == 3)
+            {
+                ObjectStore(args[1]).remove(args[2]);
+            }
+            else if (command == "list" && args.size() == 2)
+            {
+                ObjectStore(args[1]).list(cout);
+            }
+            else
+            {
+                cerr << "ERROR: store requires put, get, delete or list and its arguments" << endl;
+                printUsage();
+                return 1;
+            }
+        }
         else
         {
-            cerr << "ERROR: Invalid mode. Use 'encode' or 'decode'" << endl;
+            cerr << "ERROR: Invalid mode. Use 'encode', 'decode', 'keygen', 'verify', 'scan', 'info', "
+                 << "'logdump', 'daemon', 'bench', 'selftest' or 'store'" << endl;
             printUsage();
             return 1;
         }